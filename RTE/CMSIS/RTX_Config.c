@@ -28,11 +28,24 @@
 #include "cmsis_compiler.h"
 #include "rtx_os.h"
  
-// OS Idle Thread
+extern uint32_t lowPowerSleep (uint32_t ticks);     // src/lowPower.c
+
+// OS Idle Thread: tickless, sleeps until the next timeout or interrupt
 __WEAK __NO_RETURN void osRtxIdleThread (void *argument) {
+  uint32_t ticks;
   (void)argument;
 
-  for (;;) {}
+  for (;;) {
+    ticks = osKernelSuspend();
+    __disable_irq();                      // pending interrupts still end WFI
+    if (osRtxInfo.thread.ready.thread_list != NULL) {
+      ticks = 0U;                         // an interrupt readied a thread after the suspend
+    } else {
+      ticks = lowPowerSleep(ticks);
+    }
+    __enable_irq();
+    osKernelResume(ticks);
+  }
 }
  
 // OS Error Callback function
@@ -0,0 +1,228 @@
+/* ======================================================
+    baud: negotiated baud rates and the throughput at each
+
+    Usage: bench_baud [--rounds N] [--skew PPM]
+
+    Runs the firmware in the simulator, with the host's serial
+    port at its own baud rate, and for each of 115200, 230400,
+    460800 and 921600 baud:
+      * negotiates the rate with 'baud <rate>': on 'switching'
+        the host changes rate, waits 10 ms and confirms with
+        'baud'; without 'ok' within 3 s it changes back
+      * runs 'txtest' N times (default 8), each 16 lines of 64
+        bytes, and times the test lines from the first byte of
+        each round to its last
+
+    The host's rate is the nominal rate offset by PPM parts per
+    million (default 0); each byte is decoded as the host samples
+    it (sim_uartHostBaud), so the test lines are received intact
+    only while the board's and the host's rates are close enough.
+    Reports the board's actual rate and error, the bytes/s, the
+    efficiency against 10 bits per byte, and the test lines
+    expected and lost or corrupted.
+    ========================================================= */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "serialPort.h"
+
+int lab4_main(void) ;
+
+#define LINE_MAX (120)
+#define TEST_LINE "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ"
+#define TEST_LINES (16)                 // per txtest
+#define SWITCH_NS (10000000ull)         // host: wait after 'switching'
+#define CONFIRM_NS (3000000000ull)      // host: wait for 'ok'
+#define REPORT_NS (2000000000ull)       // host: wait for the txtest report
+
+static const uint32_t rates[] = { 115200, 230400, 460800, 921600 } ;
+#define NUM_RATES (sizeof(rates) / sizeof(rates[0]))
+
+typedef struct {
+    bool negotiated ;
+    BaudInfo_t baud ;
+    unsigned long good ;                // test lines received intact
+    uint64_t bytes ;                    // in test lines, intact or not, after the first of each round
+    uint64_t ns ;                       // first byte to last line end of each round
+} Result_t ;
+
+static Result_t results[NUM_RATES] ;
+static unsigned int rounds = 8 ;
+static long skewPpm ;
+
+// Line assembly and timing, in the peripheral thread
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER ;
+static pthread_cond_t seenCond ;       // on CLOCK_MONOTONIC, as sim_hostTime
+static const char *waitFor ;            // text awaited in a line
+static bool seen ;
+static bool measuring ;                 // a txtest round, until its report
+static unsigned long good ;             // test lines intact in the round
+static uint64_t roundStart, roundEnd ;  // first byte, last test line end
+static unsigned long roundBytes, testBytes ;    // bytes after the first
+
+static void onTx(uint8_t c) {
+    static char line[LINE_MAX + 1] ;
+    static unsigned int len ;
+    uint64_t now = sim_nanos() ;
+
+    pthread_mutex_lock(&lock) ;
+    if (measuring) {
+        if (roundStart == 0) {
+            roundStart = now ;
+            len = 0 ;                   // the prompt before the round
+        } else {
+            roundBytes++ ;
+        }
+    }
+    if (c != '\n') {
+        if (c != '\r' && len < LINE_MAX) line[len++] = c ;
+        pthread_mutex_unlock(&lock) ;
+        return ;
+    }
+    line[len] = '\0' ;
+    len = 0 ;
+    if (measuring && strstr(line, " irqs, ") != NULL) {
+        measuring = false ;
+    } else if (measuring) {
+        if (strcmp(line, TEST_LINE) == 0) good++ ;
+        roundEnd = now ;
+        testBytes = roundBytes ;
+    }
+    if (waitFor != NULL && strstr(line, waitFor) != NULL) {
+        seen = true ;
+        pthread_cond_broadcast(&seenCond) ;
+    }
+    pthread_mutex_unlock(&lock) ;
+}
+
+// Send a command and wait up to ns for a line containing text;
+//   false on timeout
+static bool command(const char *text, const char *reply, uint64_t ns) {
+    uint64_t deadline = sim_nanos() + ns ;
+    struct timespec t ;
+    bool found ;
+
+    sim_hostTime(deadline, &t) ;
+    pthread_mutex_lock(&lock) ;
+    waitFor = reply ;
+    seen = false ;
+    pthread_mutex_unlock(&lock) ;
+    sim_uartInject(text, strlen(text)) ;
+
+    pthread_mutex_lock(&lock) ;
+    while (!seen && pthread_cond_timedwait(&seenCond, &lock, &t) == 0) ;
+    found = seen ;
+    waitFor = NULL ;
+    pthread_mutex_unlock(&lock) ;
+    return found ;
+}
+
+static uint32_t skewed(uint32_t baud) {
+    return (uint32_t)((int64_t)baud * (1000000 + skewPpm) / 1000000) ;
+}
+
+static bool negotiate(uint32_t baud, uint32_t oldBaud) {
+    char text[32], reply[32] ;
+
+    sprintf(text, "baud %u\r\n", baud) ;
+    sprintf(reply, "baud %u switching", baud) ;
+    if (!command(text, reply, CONFIRM_NS)) return false ;
+
+    sim_uartHostBaud(skewed(baud)) ;
+    sim_sleepUntil(sim_nanos() + SWITCH_NS) ;
+    sprintf(reply, "baud %u ok", baud) ;
+    if (command("baud\r\n", reply, CONFIRM_NS)) return true ;
+    sim_uartHostBaud(skewed(oldBaud)) ;
+    return false ;
+}
+
+static void measure(Result_t *r) {
+    for (unsigned int i = 0 ; i < rounds ; i++) {
+        sim_sleepUntil(sim_nanos() + SWITCH_NS) ;  // the prompt is sent
+        pthread_mutex_lock(&lock) ;
+        roundStart = roundEnd = 0 ;
+        roundBytes = testBytes = 0 ;
+        good = 0 ;
+        measuring = true ;
+        pthread_mutex_unlock(&lock) ;
+
+        command("txtest\r\n", " irqs, ", REPORT_NS) ;
+
+        pthread_mutex_lock(&lock) ;
+        measuring = false ;
+        if (roundEnd > roundStart) {
+            r->ns += roundEnd - roundStart ;
+            r->bytes += testBytes ;
+        }
+        r->good += good ;
+        pthread_mutex_unlock(&lock) ;
+    }
+}
+
+static void *driver(void *arg) {
+    uint32_t baud = 115200 ;
+    (void)arg ;
+
+    sim_uartHostBaud(skewed(baud)) ;
+    sim_sleepUntil(200000000ull) ;
+    for (unsigned int i = 0 ; i < NUM_RATES ; i++) {
+        Result_t *r = &results[i] ;
+
+        r->negotiated = negotiate(rates[i], baud) ;
+        if (!r->negotiated) continue ;
+        baud = rates[i] ;
+        getBaudInfo(&r->baud) ;
+        measure(r) ;
+    }
+
+    printf("host skew %+ld ppm, %u x %u test lines per rate\n", skewPpm, rounds, TEST_LINES) ;
+    printf("%8s %9s %8s %10s %11s %7s %5s\n", "baud", "actual", "error", "bytes/s", "efficiency", "lines", "bad") ;
+    for (unsigned int i = 0 ; i < NUM_RATES ; i++) {
+        Result_t *r = &results[i] ;
+        double actual, rate ;
+        unsigned long expected = (unsigned long)rounds * TEST_LINES ;
+
+        if (!r->negotiated) {
+            printf("%8u  not negotiated\n", rates[i]) ;
+            continue ;
+        }
+        actual = (double)r->baud.clock / ((double)r->baud.sbr * r->baud.osr) ;
+        rate = (r->ns > 0) ? r->bytes * 1e9 / r->ns : 0 ;
+        printf("%8u %9.0f %+7.2f%% %10.0f %10.1f%% %7lu %5lu\n", rates[i], actual,
+               r->baud.errorPpm / 1e4, rate, rate * 10 * 100 / actual, expected, expected - r->good) ;
+    }
+    exit(0) ;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { -1, -1, -1 } ;
+    pthread_condattr_t attr ;
+    pthread_t thread ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--rounds") == 0 && i + 1 < argc) {
+            rounds = strtoul(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--skew") == 0 && i + 1 < argc) {
+            skewPpm = strtol(argv[++i], NULL, 10) ;
+        } else {
+            fprintf(stderr, "usage: %s [--rounds N] [--skew PPM]\n", argv[0]) ;
+            return 2 ;
+        }
+    }
+    if (rounds < 1) rounds = 1 ;
+
+    pthread_condattr_init(&attr) ;
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) ;
+    pthread_cond_init(&seenCond, &attr) ;
+
+    config.uartOut = open("/dev/null", O_WRONLY) ;
+    sim_timeInit() ;
+    sim_txHook = onTx ;
+    sim_start(&config) ;
+    pthread_create(&thread, NULL, driver, NULL) ;
+    return lab4_main() ;
+}
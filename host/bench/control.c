@@ -0,0 +1,183 @@
+/* ======================================================
+    control: commands at line rate through controlIQ
+
+    Usage: bench_control [--commands N] [--seed S]
+
+    Runs the firmware in the simulator and sends N commands
+    (default 2000) back to back at 115200 baud: faster, slower,
+    'set <green> <red>' and 'bright <percent>' chosen at random
+    (seed S, default 1). The bench works out the schedule each
+    command leaves, as the command thread does, then asks for the
+    'control' report and checks that
+      * every command queued a message: none refused as busy,
+        rejected or lost to a receive overrun, so the command
+        thread never blocked long enough to fall behind the line
+      * the LED thread received every message and the last
+        sequence number
+      * the schedule it applied is the one the last command left
+
+    Reports the counts, the messages coalesced and the longest
+    from sending a message to the LED thread taking it. Exits
+    with status 1 if a check fails.
+    ========================================================= */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "serialPort.h"
+
+int lab4_main(void) ;
+
+#define LINE_MAX (120)
+#define PENDING_MAX (1024)              // injected bytes kept waiting
+#define NUM_TIMES (8)
+
+// The command thread's state, as main.c starts it
+static const uint32_t times[NUM_TIMES] = { 500, 1000, 1500, 2000, 2500, 3000, 3500, 4000 } ;
+static int speed = 3 ;
+static uint32_t green = 2000, red = 2000, bright = 100 ;
+
+static unsigned long commands = 2000 ;
+static unsigned int seed = 1 ;
+
+// Replies, in the peripheral thread
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER ;
+static pthread_cond_t reported = PTHREAD_COND_INITIALIZER ;
+static unsigned long errors ;           // 'busy', rejected or unrecognised replies
+static bool haveStats, haveApplied ;
+static unsigned int sent, busy, received, applied, seq, latency ;
+static unsigned int appliedGreen, appliedRed, appliedBright ;
+
+static void onTx(uint8_t c) {
+    static char line[LINE_MAX + 1] ;
+    static unsigned int len ;
+    char *p ;
+
+    if (c != '\n') {
+        if (c != '\r' && len < LINE_MAX) line[len++] = c ;
+        return ;
+    }
+    line[len] = '\0' ;
+    len = 0 ;
+
+    pthread_mutex_lock(&lock) ;
+    if (strstr(line, ">busy") || strcmp(line, "busy") == 0 || strstr(line, "not recognised") || strstr(line, "invalid argument") ||
+        strstr(line, "on-times are") || strstr(line, "brightness is")) {
+        errors++ ;
+    }
+    if ((p = strstr(line, "control sent")) != NULL &&
+        sscanf(p, "control sent %u busy %u received %u applied %u seq %u latency %u",
+               &sent, &busy, &received, &applied, &seq, &latency) == 6) {
+        haveStats = true ;
+    }
+    if ((p = strstr(line, "applied green")) != NULL &&
+        sscanf(p, "applied green %u red %u bright %u", &appliedGreen, &appliedRed, &appliedBright) == 3) {
+        haveApplied = true ;
+        pthread_cond_signal(&reported) ;
+    }
+    pthread_mutex_unlock(&lock) ;
+}
+
+// The next command, and the schedule it leaves
+static int nextCommand(char *buf) {
+    unsigned int r = rand_r(&seed) % 10 ;
+
+    if (r < 4) {
+        speed = (speed + NUM_TIMES - 1) % NUM_TIMES ;
+        green = red = times[speed] ;
+        return sprintf(buf, "faster\r\n") ;
+    }
+    if (r < 7) {
+        speed = (speed + 1) % NUM_TIMES ;
+        green = red = times[speed] ;
+        return sprintf(buf, "slower\r\n") ;
+    }
+    if (r < 9) {
+        green = 10 + rand_r(&seed) % 59991 ;
+        red = 10 + rand_r(&seed) % 59991 ;
+        return sprintf(buf, "set %u %u\r\n", green, red) ;
+    }
+    bright = rand_r(&seed) % 101 ;
+    return sprintf(buf, "bright %u\r\n", bright) ;
+}
+
+static bool check(const char *name, bool ok) {
+    printf("%-26s %s\n", name, ok ? "ok" : "FAIL") ;
+    return ok ;
+}
+
+static void *driver(void *arg) {
+    char buf[32] ;
+    uint64_t start, elapsed ;
+    bool ok = true ;
+    int n ;
+    (void)arg ;
+
+    // the startup report and the first prompt
+    sim_sleepUntil(200000000ull) ;
+    start = sim_nanos() ;
+    for (unsigned long i = 0 ; i < commands ; i++) {
+        n = nextCommand(buf) ;
+        while (sim_uartInjectPending() > PENDING_MAX) {
+            sim_sleepUntil(sim_nanos() + 1000000ull) ;
+        }
+        sim_uartInject(buf, n) ;
+    }
+    while (sim_uartInjectPending() > 0) {
+        sim_sleepUntil(sim_nanos() + 1000000ull) ;
+    }
+    elapsed = sim_nanos() - start ;
+
+    // let the replies drain, then ask for the report
+    sim_sleepUntil(sim_nanos() + 500000000ull) ;
+    sim_uartInject("control\r\n", 9) ;
+    pthread_mutex_lock(&lock) ;
+    while (!(haveStats && haveApplied)) pthread_cond_wait(&reported, &lock) ;
+    pthread_mutex_unlock(&lock) ;
+
+    printf("commands                   %lu in %.2f s, %.0f/s\n", commands, elapsed / 1e9,
+           commands * 1e9 / elapsed) ;
+    printf("messages sent              %u, %u busy\n", sent, busy) ;
+    printf("received                   %u, last seq %u\n", received, seq) ;
+    printf("applied                    %u, %u coalesced\n", applied, received - applied) ;
+    printf("longest latency            %u ms\n", latency) ;
+    printf("rx overruns                %u\n", getRxOverruns()) ;
+    printf("error replies seen         %lu\n", errors) ;
+    printf("applied schedule           green %u red %u bright %u\n", appliedGreen, appliedRed, appliedBright) ;
+    printf("expected schedule          green %u red %u bright %u\n", green, red, bright) ;
+
+    // one message at startup, then one per command
+    ok &= check("all commands queued", sent == commands + 1 && busy == 0 && errors == 0) ;
+    ok &= check("no receive overruns", getRxOverruns() == 0) ;
+    ok &= check("all messages received", received == sent && seq == (sent & 0xFFFF)) ;
+    ok &= check("latest schedule applied",
+                appliedGreen == green && appliedRed == red && appliedBright == bright) ;
+    exit(ok ? 0 : 1) ;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { -1, -1, -1 } ;
+    pthread_t thread ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--commands") == 0 && i + 1 < argc) {
+            commands = strtoul(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], NULL, 10) ;
+        } else {
+            fprintf(stderr, "usage: %s [--commands N] [--seed S]\n", argv[0]) ;
+            return 2 ;
+        }
+    }
+    if (commands < 1) commands = 1 ;
+
+    config.uartOut = open("/dev/null", O_WRONLY) ;
+    sim_timeInit() ;
+    sim_txHook = onTx ;
+    sim_start(&config) ;
+    pthread_create(&thread, NULL, driver, NULL) ;
+    return lab4_main() ;
+}
@@ -0,0 +1,92 @@
+/* ======================================================
+    drift: long-run LED timing error
+
+    Usage: bench_drift [--transitions N] [--scale S]
+
+    Runs the firmware in the simulator with simulated time S 
+    times faster than host time (default 250), sets the on-time
+    to 500 ms with three 'faster' commands, one per transition
+    so each is applied before the next is sent (the control
+    queue, CONTROLIQ_COUNT deep, is never the limit), and records
+    every LED transition. The cumulative error of transition n 
+    is its time less (reference + n x 500 ms), where the 
+    reference is the first transition 500 ms after the one 
+    before it. Reports the final, mean and largest errors over
+    N transitions (default 10000).
+
+    The firmware's LED driver, LED_GPIO by default, leaves the 
+    LED thread and the deadline engine to time the transitions.
+    ========================================================= */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+int lab4_main(void) ;
+
+#define ONTIME_NS (500000000ll)
+#define TICK_NS (1000000.0)
+
+static long transitions = 10000 ;
+static long count = -1 ;            // transitions at 500 ms; -1 before the reference
+static int fasterSent ;
+static unsigned int lastColour ;
+static uint64_t last, reference ;
+static double sumError, maxError, finalError ;
+
+static void onLED(uint64_t ns, unsigned int rgb) {
+    // a transition is a change to red alone or green alone
+    if ((rgb != SIM_RED && rgb != SIM_GREEN) || rgb == lastColour) return ;
+    lastColour = rgb ;
+    
+    // step the on-time down to 500 ms, then wait for an interval of 500 ms
+    if (count < 0) {
+        if (fasterSent < 3) {
+            sim_uartInject("faster\r\n", 8) ;
+            fasterSent++ ;
+        } else if (last != 0 && llabs((int64_t)(ns - last) - ONTIME_NS) < TICK_NS) {
+            reference = ns ;
+            count = 0 ;
+        }
+        last = ns ;
+        return ;
+    }
+    count++ ;
+    finalError = ((double)ns - (double)reference - (double)count * ONTIME_NS) / TICK_NS ;
+    sumError += finalError ;
+    if (finalError > maxError || -finalError > maxError) maxError = finalError < 0 ? -finalError : finalError ;
+    
+    if (count == transitions) {
+        printf("transitions        %ld at 500 ms\n", count) ;
+        printf("final error        %.3f ticks\n", finalError) ;
+        printf("mean error         %.3f ticks\n", sumError / count) ;
+        printf("max |error|        %.3f ticks\n", maxError) ;
+        printf("drift              %.6f ticks per transition\n", finalError / count) ;
+        exit(0) ;
+    }
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { -1, -1, -1 } ;
+    uint32_t scale = 250 ;
+    
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--transitions") == 0 && i + 1 < argc) {
+            transitions = strtol(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = strtoul(argv[++i], NULL, 10) ;
+        } else {
+            fprintf(stderr, "usage: %s [--transitions N] [--scale S]\n", argv[0]) ;
+            return 2 ;
+        }
+    }
+    
+    config.uartOut = open("/dev/null", O_WRONLY) ;
+    sim_timeInit() ;
+    sim_setTimeScale(scale) ;
+    sim_ledHook = onLED ;
+    sim_start(&config) ;
+    return lab4_main() ;
+}
@@ -0,0 +1,139 @@
+/* ======================================================
+    frames: binary protocol throughput
+
+    Usage: bench_frames [--frames N] [--window W] [--faster]
+
+    Runs the firmware in the simulator, switches it to the
+    binary protocol with the 'binary' command and sends N
+    frames (default 10000), OP_PING or, with --faster,
+    OP_FASTER, keeping up to W (default 4) sent but not yet
+    acknowledged. Every acknowledgement is parsed and checked.
+    Reports the frames acknowledged per second of simulated
+    time, by status, then returns to the text prompt with
+    OP_TEXT and prints the firmware's receive counts.
+
+    A ping is 4 bytes and its acknowledgement 5, so at 115200
+    baud transmit limits the rate to about 2300 frames/s.
+    ========================================================= */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "frame.h"
+
+int lab4_main(void) ;
+
+static unsigned int frames = 10000 ;
+static unsigned int window = 4 ;
+static uint8_t opcode = OP_PING ;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER ;
+static pthread_cond_t acked = PTHREAD_COND_INITIALIZER ;
+static unsigned int acks, badAcks ;
+static unsigned int statusCount[ACK_BADARG + 1] ;
+static bool textMode ;              // OP_TEXT acknowledged: the report follows
+
+// Acknowledgement parser, fed each byte transmitted
+static void onTx(uint8_t c) {
+    static uint8_t buf[FRAME_MAX_PAYLOAD + FRAME_OVERHEAD] ;
+    static unsigned int n ;
+    static char line[120] ;
+    static unsigned int len ;
+
+    if (textMode) {
+        if (c == '\n') {
+            line[len] = '\0' ;
+            printf("firmware           %s\n", line) ;
+            exit(0) ;
+        }
+        if (c != '\r' && len < sizeof(line) - 1) line[len++] = c ;
+        return ;
+    }
+    if (n == 0 && c != FRAME_SYNC) return ;        // the prompt, before binary mode
+    buf[n++] = c ;
+    if (n < 2 || n < buf[1] + FRAME_OVERHEAD) return ;
+    n = 0 ;
+
+    pthread_mutex_lock(&lock) ;
+    if (buf[1] != 1 || buf[4] != crc8(0, &buf[1], 3) || buf[3] > ACK_BADARG) {
+        badAcks++ ;
+    } else if (buf[2] == (OP_TEXT | OP_ACK)) {
+        textMode = true ;
+    } else {
+        statusCount[buf[3]]++ ;
+    }
+    acks++ ;
+    pthread_cond_signal(&acked) ;
+    pthread_mutex_unlock(&lock) ;
+}
+
+static void injectFrame(uint8_t op) {
+    char frame[FRAME_OVERHEAD] = { (char)FRAME_SYNC, 0, (char)op } ;
+
+    frame[3] = (char)crc8(0, (uint8_t *)&frame[1], 2) ;
+    sim_uartInject(frame, FRAME_OVERHEAD) ;
+}
+
+static void *driver(void *arg) {
+    uint64_t start, elapsed ;
+    (void)arg ;
+
+    // wait for the prompt to settle, then switch to binary
+    sim_sleepUntil(100000000ull) ;
+    sim_uartInject("binary\r\n", 8) ;
+    sim_sleepUntil(200000000ull) ;
+
+    start = sim_nanos() ;
+    pthread_mutex_lock(&lock) ;
+    for (unsigned int sent = 0 ; sent < frames ; sent++) {
+        while (sent - acks >= window) pthread_cond_wait(&acked, &lock) ;
+        pthread_mutex_unlock(&lock) ;
+        injectFrame(opcode) ;
+        pthread_mutex_lock(&lock) ;
+    }
+    while (acks < frames) pthread_cond_wait(&acked, &lock) ;
+    elapsed = sim_nanos() - start ;
+    pthread_mutex_unlock(&lock) ;
+
+    printf("frames             %u, window %u\n", frames, window) ;
+    printf("rate               %.0f frames/s\n", frames / (elapsed / 1e9)) ;
+    printf("acks ok            %u\n", statusCount[ACK_OK]) ;
+    printf("acks unknown       %u\n", statusCount[ACK_UNKNOWN]) ;
+    printf("acks badlen        %u\n", statusCount[ACK_BADLEN]) ;
+    printf("acks busy          %u\n", statusCount[ACK_BUSY]) ;
+    printf("acks badarg        %u\n", statusCount[ACK_BADARG]) ;
+    printf("acks malformed     %u\n", badAcks) ;
+    fflush(stdout) ;
+
+    injectFrame(OP_TEXT) ;
+    return NULL ;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { -1, -1, -1 } ;
+    pthread_t thread ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            frames = strtoul(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--window") == 0 && i + 1 < argc) {
+            window = strtoul(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--faster") == 0) {
+            opcode = OP_FASTER ;
+        } else {
+            fprintf(stderr, "usage: %s [--frames N] [--window W] [--faster]\n", argv[0]) ;
+            return 2 ;
+        }
+    }
+    if (window == 0) window = 1 ;
+
+    config.uartOut = open("/dev/null", O_WRONLY) ;
+    sim_timeInit() ;
+    sim_txHook = onTx ;
+    sim_start(&config) ;
+    pthread_create(&thread, NULL, driver, NULL) ;
+    return lab4_main() ;
+}
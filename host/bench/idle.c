@@ -0,0 +1,107 @@
+/* ======================================================
+    idle: wakeups and estimated current, ticking and tickless
+
+    Usage: bench_idle [--time S]
+
+    Runs the firmware in the simulator for S seconds (default
+    20) with a 'slower' or 'faster' command every 5 s, and
+    counts the idle periods: times when every thread is blocked
+    (see Idle accounting in sim/core.c).
+
+      * Ticking: the SysTick interrupt wakes the core every tick,
+        and interrupts wake it between ticks. The original idle
+        thread is a busy loop, so the core never sleeps
+      * Tickless: the core wakes only when an idle period ends,
+        on a timeout or an interrupt
+
+    The currents are estimates from the typical supply currents
+    below, not measurements: replace them with values measured
+    on the board. Busy time is measured on the host and is an
+    upper bound.
+    ========================================================= */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+
+int lab4_main(void) ;
+
+// Typical supply currents, uA, at 3 V: KL25Z datasheet, FEI 20.97 MHz
+#define RUN_UA (4000.0)
+#define WAIT_UA (2100.0)
+#define VLPS_UA (40.0)          // including the slow IRC running in stop
+
+// Active time per wakeup, us: wake, kernel resume and return to sleep
+#define WAKE_US (40.0)
+
+#define COMMAND_S (5)
+
+static unsigned int seconds = 20 ;
+
+// Average current sleeping at sleepUA except for busy time and wakeups
+static double current(double sleepUA, double busyS, double wakeupsPerS, double totalS) {
+    double active = busyS / totalS + wakeupsPerS * WAKE_US / 1e6 ;
+
+    if (active > 1.0) active = 1.0 ;
+    return sleepUA + (RUN_UA - sleepUA) * active ;
+}
+
+static void *driver(void *arg) {
+    SimIdleStats_t stats ;
+    double totalS, busyS, tickless, ticking ;
+    (void)arg ;
+
+    for (unsigned int s = COMMAND_S ; s <= seconds ; s += COMMAND_S) {
+        sim_sleepUntil(s * 1000000000ull) ;
+        if (s < seconds) {
+            if ((s / COMMAND_S) % 2) {
+                sim_uartInject("slower\r\n", 8) ;
+            } else {
+                sim_uartInject("faster\r\n", 8) ;
+            }
+        }
+    }
+    sim_getIdleStats(&stats) ;
+
+    totalS = stats.ns / 1e9 ;
+    busyS = (stats.ns - stats.idleNs) / 1e9 ;
+    tickless = stats.wakeups / totalS ;
+    ticking = 1000.0 + stats.irqWakeups / totalS ;
+
+    printf("simulated          %.1f s, idle %.2f%%\n", totalS, 100.0 * stats.idleNs / stats.ns) ;
+    printf("idle periods       %u, %u ended by an interrupt\n", stats.wakeups, stats.irqWakeups) ;
+    printf("\n%-28s %12s %12s\n", "", "wakeups/s", "current uA") ;
+    printf("%-28s %12.1f %12.0f\n", "ticking, busy-wait idle", ticking, RUN_UA) ;
+    printf("%-28s %12.1f %12.0f\n", "ticking, WFI", ticking,
+           current(WAIT_UA, busyS, ticking, totalS)) ;
+    printf("%-28s %12.1f %12.0f\n", "tickless, LP_WAIT", tickless,
+           current(WAIT_UA, busyS, tickless, totalS)) ;
+    printf("%-28s %12.1f %12.0f\n", "tickless, LP_VLPS", tickless,
+           current(VLPS_UA, busyS, tickless, totalS)) ;
+    exit(0) ;
+    return NULL ;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { -1, -1, -1 } ;
+    pthread_t thread ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            seconds = strtoul(argv[++i], NULL, 10) ;
+        } else {
+            fprintf(stderr, "usage: %s [--time S]\n", argv[0]) ;
+            return 2 ;
+        }
+    }
+
+    config.uartOut = open("/dev/null", O_WRONLY) ;
+    sim_timeInit() ;
+    sim_start(&config) ;
+    pthread_create(&thread, NULL, driver, NULL) ;
+    return lab4_main() ;
+}
@@ -0,0 +1,174 @@
+/* ======================================================
+    jitter: LED transition jitter, quiet and under a flood
+
+    Usage: bench_jitter [--seconds S] [--rows]
+
+    Runs the firmware, built with LATENCY_PROBE, in the simulator
+    with 20 ms on-times timed by the LED thread ('bright 50') and
+    reports how late the thread sets the LEDs after each
+    transition's deadline: the 50th and 99th percentile and the
+    longest, over S seconds (default 3)
+      * with no serial input
+      * with the input flooded at line rate by 'help', 'mem',
+        'control', 'stacks' and unrecognised lines, which keep
+        the command thread parsing and waiting to send
+
+    Each row is labelled with the scheduling profile built
+    (LED_PRIORITY, COMMAND_PRIORITY, OS_ROBIN_ENABLE); --rows
+    leaves out the heading, so that the rows of the profiles
+    built by CMake (jitter_profiles target) form one table. The
+    simulation runs threads concurrently and does not model
+    priorities. Exits with status 2 if the probe is not built.
+    ========================================================= */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+int lab4_main(void) ;
+
+#define LINE_MAX (120)
+#define PENDING_MAX (256)               // flood bytes kept waiting
+#define REPORT_NS (2000000000ull)       // wait for the jitter report
+
+static const char * const flood[] = { "help\r\n", "mem\r\n", "control\r\n", "stacks\r\n", "xyzzy 42\r\n" } ;
+#define NUM_FLOOD (sizeof(flood) / sizeof(flood[0]))
+
+static unsigned long seconds = 3 ;
+static bool rowsOnly ;
+
+// Reports, in the peripheral thread
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER ;
+static pthread_cond_t reportCond ;      // on CLOCK_MONOTONIC, as sim_hostTime
+static bool reported, haveConfig, notBuilt ;
+static unsigned int count, p50, p99, max ;
+static int ledPriority, commandPriority, robin ;
+
+static void onTx(uint8_t c) {
+    static char line[LINE_MAX + 1] ;
+    static unsigned int len ;
+    char *p ;
+
+    if (c != '\n') {
+        if (c != '\r' && len < LINE_MAX) line[len++] = c ;
+        return ;
+    }
+    line[len] = '\0' ;
+    len = 0 ;
+
+    pthread_mutex_lock(&lock) ;
+    if ((p = strstr(line, "jitter n=")) != NULL &&
+        sscanf(p, "jitter n=%u p50=%u p99=%u max=%u", &count, &p50, &p99, &max) == 4) {
+        reported = true ;
+    }
+    if (reported && (p = strstr(line, "led priority")) != NULL &&
+        sscanf(p, "led priority %d command priority %d round-robin %d",
+               &ledPriority, &commandPriority, &robin) == 3) {
+        haveConfig = true ;
+        pthread_cond_broadcast(&reportCond) ;
+    }
+    if (strstr(line, "latency probe not enabled") != NULL) {
+        notBuilt = true ;
+        pthread_cond_broadcast(&reportCond) ;
+    }
+    pthread_mutex_unlock(&lock) ;
+}
+
+// Request the report, which starts the next measurement; false on timeout
+static bool report(void) {
+    struct timespec t ;
+    bool ok ;
+
+    sim_hostTime(sim_nanos() + REPORT_NS, &t) ;
+    pthread_mutex_lock(&lock) ;
+    reported = haveConfig = false ;
+    pthread_mutex_unlock(&lock) ;
+    sim_uartInject("jitter\r\n", 8) ;
+
+    pthread_mutex_lock(&lock) ;
+    while (!(reported && haveConfig) && !notBuilt &&
+           pthread_cond_timedwait(&reportCond, &lock, &t) == 0) ;
+    ok = reported && haveConfig ;
+    pthread_mutex_unlock(&lock) ;
+    return ok ;
+}
+
+static void row(const char *name, bool ok) {
+    printf("led %2d command %2d rr %d   %-6s", ledPriority, commandPriority, robin, name) ;
+    if (ok) {
+        printf(" %12u %8u %8u %8u\n", count, p50, p99, max) ;
+    } else {
+        printf("  no report\n") ;
+    }
+}
+
+static void *driver(void *arg) {
+    uint64_t end ;
+    bool ok ;
+    (void)arg ;
+
+    sim_sleepUntil(200000000ull) ;
+    sim_uartInject("bright 50\r\nset 20\r\n", 19) ;
+    sim_sleepUntil(sim_nanos() + 200000000ull) ;
+    if (!report()) {
+        fprintf(stderr, notBuilt ? "build with -DLATENCY_PROBE=ON\n" : "no jitter report\n") ;
+        exit(2) ;
+    }
+    if (!rowsOnly) {
+        printf("20 ms on-times, %lu s each\n", seconds) ;
+        printf("%-24s %-6s %12s %8s %8s %8s\n", "profile", "input", "transitions", "p50 us", "p99 us", "max us") ;
+    }
+
+    sim_sleepUntil(sim_nanos() + seconds * 1000000000ull) ;
+    row("quiet", report()) ;
+
+    end = sim_nanos() + seconds * 1000000000ull ;
+    for (unsigned int i = 0 ; sim_nanos() < end ; ) {
+        if (sim_uartInjectPending() < PENDING_MAX) {
+            sim_uartInject(flood[i], strlen(flood[i])) ;
+            i = (i + 1) % NUM_FLOOD ;
+        } else {
+            sim_sleepUntil(sim_nanos() + 1000000ull) ;
+        }
+    }
+    // the report covers the flood and its output draining; the
+    //   request may be lost to a receive overrun, so is repeated
+    while (sim_uartInjectPending() > 0) {
+        sim_sleepUntil(sim_nanos() + 1000000ull) ;
+    }
+    for (int tries = 0 ; tries < 3 && !(ok = report()) ; tries++) ;
+    row("flood", ok) ;
+    exit(ok ? 0 : 1) ;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { -1, -1, -1 } ;
+    pthread_condattr_t attr ;
+    pthread_t thread ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+            seconds = strtoul(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--rows") == 0) {
+            rowsOnly = true ;
+        } else {
+            fprintf(stderr, "usage: %s [--seconds S] [--rows]\n", argv[0]) ;
+            return 2 ;
+        }
+    }
+    if (seconds < 1) seconds = 1 ;
+
+    pthread_condattr_init(&attr) ;
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) ;
+    pthread_cond_init(&reportCond, &attr) ;
+
+    config.uartOut = open("/dev/null", O_WRONLY) ;
+    sim_timeInit() ;
+    sim_txHook = onTx ;
+    sim_start(&config) ;
+    pthread_create(&thread, NULL, driver, NULL) ;
+    return lab4_main() ;
+}
@@ -0,0 +1,186 @@
+/* ======================================================
+    latency: command to LED latency percentiles
+
+    Usage: bench_latency [--commands N] [--max-p99 US] [--row]
+
+    Runs the firmware, built with LATENCY_PROBE, in the simulator
+    and sends N 'faster' commands (default 1000) in bursts of 1,
+    2, 4 and 8 back to back, a burst every 2 ms after the last
+    has been received, so that up to 8 messages wait in controlIQ.
+    After each set of bursts the 'latency' report gives the
+    samples and the 50th and 99th percentile and longest time
+    from a line end in the UART0 handler to the LED thread
+    applying the schedule.
+
+    Thread priorities and the controlIQ depth are those built
+    (LED_PRIORITY, COMMAND_PRIORITY, CONTROLIQ_COUNT) and are
+    reported; the simulation does not model priorities. With
+    --row, a single row gives the configuration and the
+    percentiles over all the bursts, so that the benches of the
+    configurations built by CMake (latency_sweep target) form
+    one table. Exits with status 1 if a 99th percentile exceeds
+    US (--max-p99), or 2 if the probe is not built.
+    ========================================================= */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+int lab4_main(void) ;
+
+#define LINE_MAX (120)
+#define GAP_NS (2000000ull)             // after each burst is received
+#define REPORT_NS (2000000000ull)       // wait for the latency report
+
+static const unsigned int bursts[] = { 1, 2, 4, 8 } ;
+#define NUM_BURSTS (sizeof(bursts) / sizeof(bursts[0]))
+
+static unsigned long commands = 1000 ;
+static unsigned long maxP99 ;           // 0: no limit
+static bool oneRow ;
+
+// Reports, in the peripheral thread
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER ;
+static pthread_cond_t reportCond ;      // on CLOCK_MONOTONIC, as sim_hostTime
+static bool reported, haveConfig, notBuilt ;
+static unsigned int count, p50, p99, max ;
+static char config[LINE_MAX + 1] ;
+static int ledPriority, commandPriority, robin, depth ;
+
+static void onTx(uint8_t c) {
+    static char line[LINE_MAX + 1] ;
+    static unsigned int len ;
+    char *p ;
+
+    if (c != '\n') {
+        if (c != '\r' && len < LINE_MAX) line[len++] = c ;
+        return ;
+    }
+    line[len] = '\0' ;
+    len = 0 ;
+
+    pthread_mutex_lock(&lock) ;
+    if ((p = strstr(line, "latency n=")) != NULL &&
+        sscanf(p, "latency n=%u p50=%u p99=%u max=%u", &count, &p50, &p99, &max) == 4) {
+        reported = true ;
+    }
+    if ((p = strstr(line, "led priority")) != NULL) {
+        strcpy(config, p) ;
+        sscanf(p, "led priority %d command priority %d round-robin %d controlIQ %d",
+               &ledPriority, &commandPriority, &robin, &depth) ;
+        haveConfig = true ;
+        pthread_cond_broadcast(&reportCond) ;
+    }
+    if (strstr(line, "latency probe not enabled") != NULL) {
+        notBuilt = true ;
+        pthread_cond_broadcast(&reportCond) ;
+    }
+    pthread_mutex_unlock(&lock) ;
+}
+
+// Request the report, which starts the next measurement; false on timeout
+static bool report(void) {
+    struct timespec t ;
+    bool ok ;
+
+    sim_hostTime(sim_nanos() + REPORT_NS, &t) ;
+    pthread_mutex_lock(&lock) ;
+    reported = haveConfig = false ;
+    pthread_mutex_unlock(&lock) ;
+    sim_uartInject("latency\r\n", 9) ;
+
+    pthread_mutex_lock(&lock) ;
+    while (!(reported && haveConfig) && !notBuilt &&
+           pthread_cond_timedwait(&reportCond, &lock, &t) == 0) ;
+    ok = reported && haveConfig ;
+    pthread_mutex_unlock(&lock) ;
+    return ok ;
+}
+
+static void waitReceived(void) {
+    while (sim_uartInjectPending() > 0) {
+        sim_sleepUntil(sim_nanos() + 100000ull) ;
+    }
+}
+
+// Send the commands in bursts of size
+static void sendBursts(unsigned int size) {
+    for (unsigned long sent = 0 ; sent < commands ; ) {
+        for (unsigned int j = 0 ; j < size && sent < commands ; j++, sent++) {
+            sim_uartInject("faster\r\n", 8) ;
+        }
+        waitReceived() ;
+        sim_sleepUntil(sim_nanos() + GAP_NS) ;
+    }
+}
+
+static void *driver(void *arg) {
+    bool ok = true ;
+    (void)arg ;
+
+    sim_sleepUntil(200000000ull) ;
+    if (!report()) {
+        fprintf(stderr, notBuilt ? "build with -DLATENCY_PROBE=ON\n" : "no latency report\n") ;
+        exit(2) ;
+    }
+    if (oneRow) {
+        for (unsigned int i = 0 ; i < NUM_BURSTS ; i++) sendBursts(bursts[i]) ;
+        ok = report() ;
+        printf("led %2d command %2d rr %d controlIQ %2d", ledPriority, commandPriority, robin, depth) ;
+        if (ok) {
+            printf(" %8u %8u %8u %8u\n", count, p50, p99, max) ;
+        } else {
+            printf("  no report\n") ;
+        }
+        if (maxP99 != 0 && p99 > maxP99) ok = false ;
+        exit(ok ? 0 : 1) ;
+    }
+    printf("%s, %lu commands per burst size\n", config, commands) ;
+    printf("%6s %8s %8s %8s %8s\n", "burst", "samples", "p50 us", "p99 us", "max us") ;
+    for (unsigned int i = 0 ; i < NUM_BURSTS ; i++) {
+        sendBursts(bursts[i]) ;
+        if (!report()) {
+            printf("%6u  no report\n", bursts[i]) ;
+            ok = false ;
+            continue ;
+        }
+        printf("%6u %8u %8u %8u %8u\n", bursts[i], count, p50, p99, max) ;
+        if (maxP99 != 0 && p99 > maxP99) ok = false ;
+    }
+    if (maxP99 != 0) printf("p99 limit %lu us: %s\n", maxP99, ok ? "ok" : "FAIL") ;
+    exit(ok ? 0 : 1) ;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { -1, -1, -1 } ;
+    pthread_condattr_t attr ;
+    pthread_t thread ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--commands") == 0 && i + 1 < argc) {
+            commands = strtoul(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--max-p99") == 0 && i + 1 < argc) {
+            maxP99 = strtoul(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--row") == 0) {
+            oneRow = true ;
+        } else {
+            fprintf(stderr, "usage: %s [--commands N] [--max-p99 US] [--row]\n", argv[0]) ;
+            return 2 ;
+        }
+    }
+    if (commands < 1) commands = 1 ;
+
+    pthread_condattr_init(&attr) ;
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) ;
+    pthread_cond_init(&reportCond, &attr) ;
+
+    config.uartOut = open("/dev/null", O_WRONLY) ;
+    sim_timeInit() ;
+    sim_txHook = onTx ;
+    sim_start(&config) ;
+    pthread_create(&thread, NULL, driver, NULL) ;
+    return lab4_main() ;
+}
@@ -0,0 +1,141 @@
+/* ======================================================
+    leds: intermediate LED states, as a logic analyser sees them
+
+    Usage: bench_leds [--transitions N] [--scale S]
+
+    Runs the firmware in the simulator with simulated time S
+    times faster than host time (default 10) and 'set 20': 20 ms
+    on-times. It records every change of the LED state, each
+    write applied at the time it was made, for N transitions
+    (default 1000) in each of two phases:
+      * software: 'bright 50', so the LED thread times the
+        transitions and sets the LEDs
+      * hardware: 'bright 100', so with the PWM driver TPM2
+        alternates the colours (bench_leds_pwm); with GPIO, the
+        default, this is the same as software
+
+    A change to a state other than red alone or green alone is
+    an intermediate state: both LEDs lit, or neither, between
+    the writes of a transition. The changes just after each
+    command, which restart the cycle, are not counted. The time
+    in each colour in the software phase includes the host's
+    scheduling delays: use --scale 1 for the firmware's own.
+    ========================================================= */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+int lab4_main(void) ;
+
+#define ONTIME_NS (20000000ll)
+#define SETTLE (2)                  // changes not counted after a command
+
+typedef struct {
+    const char *name ;
+    const char *command ;
+    long changes ;                  // LED state changes counted
+    long intermediate ;             // of which not red or green alone
+    uint64_t minDwell, maxDwell ;   // time in a red or green state
+} Phase_t ;
+
+static Phase_t phases[] = {
+    { "software", "bright 50\r\n" },
+    { "hardware", "bright 100\r\n" },
+} ;
+#define NUM_PHASES (sizeof(phases) / sizeof(phases[0]))
+
+static long transitions = 1000 ;
+static volatile int phase = -1 ;    // recording; -1 before the first
+static int settle ;
+static uint64_t last ;
+static unsigned int lastColour ;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER ;
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER ;
+
+static void onLED(uint64_t ns, unsigned int rgb) {
+    Phase_t *p ;
+    uint64_t dwell ;
+
+    rgb &= SIM_RED | SIM_GREEN ;
+    pthread_mutex_lock(&lock) ;
+    if (phase < 0 || settle > 0) {
+        if (settle > 0) settle-- ;
+        last = ns ;
+        lastColour = rgb ;
+        pthread_mutex_unlock(&lock) ;
+        return ;
+    }
+    p = &phases[phase] ;
+    if (p->changes < transitions) {
+        p->changes++ ;
+        if (rgb != SIM_RED && rgb != SIM_GREEN) p->intermediate++ ;
+        if (lastColour == SIM_RED || lastColour == SIM_GREEN) {
+            dwell = ns - last ;
+            if (p->minDwell == 0 || dwell < p->minDwell) p->minDwell = dwell ;
+            if (dwell > p->maxDwell) p->maxDwell = dwell ;
+        }
+        if (p->changes == transitions) pthread_cond_signal(&done) ;
+    }
+    last = ns ;
+    lastColour = rgb ;
+    pthread_mutex_unlock(&lock) ;
+}
+
+static void *driver(void *arg) {
+    (void)arg ;
+
+    sim_sleepUntil(100000000ull) ;
+    sim_uartInject("set 20\r\n", 8) ;
+    for (unsigned int i = 0 ; i < NUM_PHASES ; i++) {
+        sim_sleepUntil(sim_nanos() + 5 * ONTIME_NS) ;
+        pthread_mutex_lock(&lock) ;
+        phase = -1 ;
+        pthread_mutex_unlock(&lock) ;
+        sim_uartInject(phases[i].command, strlen(phases[i].command)) ;
+        sim_sleepUntil(sim_nanos() + 5 * ONTIME_NS) ;
+
+        pthread_mutex_lock(&lock) ;
+        settle = SETTLE ;
+        phase = i ;
+        while (phases[i].changes < transitions) pthread_cond_wait(&done, &lock) ;
+        pthread_mutex_unlock(&lock) ;
+    }
+
+    printf("%-10s %8s %13s %10s %10s\n", "phase", "changes", "intermediate", "min ms", "max ms") ;
+    for (unsigned int i = 0 ; i < NUM_PHASES ; i++) {
+        printf("%-10s %8ld %13ld %10.3f %10.3f\n", phases[i].name, phases[i].changes,
+               phases[i].intermediate, phases[i].minDwell / 1e6, phases[i].maxDwell / 1e6) ;
+    }
+    exit(0) ;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { -1, -1, -1 } ;
+    uint32_t scale = 10 ;
+    pthread_t thread ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--transitions") == 0 && i + 1 < argc) {
+            transitions = strtol(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = strtoul(argv[++i], NULL, 10) ;
+        } else {
+            fprintf(stderr, "usage: %s [--transitions N] [--scale S]\n", argv[0]) ;
+            return 2 ;
+        }
+    }
+    if (transitions < 1) transitions = 1 ;
+
+    config.uartOut = open("/dev/null", O_WRONLY) ;
+    sim_timeInit() ;
+    sim_setTimeScale(scale) ;
+    sim_ledHook = onLED ;
+    sim_start(&config) ;
+    pthread_create(&thread, NULL, driver, NULL) ;
+    return lab4_main() ;
+}
@@ -0,0 +1,151 @@
+/* ======================================================
+    longline: command lines longer than the receive buffer
+
+    Usage: bench_longline
+
+    Runs the firmware in the simulator and sends, each followed
+    by 'foo':
+      * a line of 200 characters, which fits in the receive
+        buffer and is answered 'not recognised'
+      * lines of 300 and 1000 characters, longer than the
+        buffer (RXBUFSIZE, 256 bytes), answered 'line too long'
+      * three lines of 300 characters and 'foo' pasted at once
+
+    Checks that each line gets its reply, in order, and that
+    'foo' is still answered after it: a line cut short must not
+    leave the console waiting for a line end it dropped. Reports
+    the receive overruns, the bytes discarded. Exits with status
+    1 if a check fails.
+    ========================================================= */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "serialPort.h"
+
+int lab4_main(void) ;
+
+#define LINE_MAX (120)
+#define SEND_MAX (4000)
+#define REPLY_NS (2000000000ull)        // wait for the reply to 'foo'
+#define REPLIES_MAX (16)
+
+// Replies, in the peripheral thread: T too long, N not recognised, F 'foo' not recognised
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER ;
+static char replies[REPLIES_MAX + 1] ;
+static unsigned int numReplies ;
+
+static void onTx(uint8_t c) {
+    static char line[LINE_MAX + 1] ;
+    static unsigned int len ;
+    char reply = 0 ;
+
+    if (c != '\n') {
+        if (c != '\r' && len < LINE_MAX) line[len++] = c ;
+        return ;
+    }
+    line[len] = '\0' ;
+    len = 0 ;
+
+    if (strstr(line, "line too long")) reply = 'T' ;
+    else if (strstr(line, ">foo not recognised")) reply = 'F' ;
+    else if (strstr(line, "not recognised")) reply = 'N' ;
+    if (reply == 0) return ;
+
+    pthread_mutex_lock(&lock) ;
+    if (numReplies < REPLIES_MAX) replies[numReplies++] = reply ;
+    pthread_mutex_unlock(&lock) ;
+}
+
+// Count of the replies to 'foo' so far
+static unsigned int fooReplies(void) {
+    unsigned int n = 0 ;
+
+    pthread_mutex_lock(&lock) ;
+    for (unsigned int i = 0 ; i < numReplies ; i++) {
+        if (replies[i] == 'F') n++ ;
+    }
+    pthread_mutex_unlock(&lock) ;
+    return n ;
+}
+
+// Append count lines of length characters, then 'foo'
+static int addLines(char *buf, int length, int count) {
+    int n = 0 ;
+
+    while (count--) {
+        memset(buf + n, 'x', length) ;
+        n += length ;
+        buf[n++] = '\r' ;
+        buf[n++] = '\n' ;
+    }
+    memcpy(buf + n, "foo\r\n", 5) ;
+    return n + 5 ;
+}
+
+static const struct {
+    const char *name ;
+    int length ;
+    int count ;
+    const char *expected ;
+} cases[] = {
+    { "200 characters",      200,  1, "NF" },
+    { "300 characters",      300,  1, "TF" },
+    { "1000 characters",     1000, 1, "TF" },
+    { "3 x 300 pasted",      300,  3, "TTTF" },
+} ;
+#define NUM_CASES (sizeof(cases) / sizeof(cases[0]))
+
+static void *driver(void *arg) {
+    static char buf[SEND_MAX] ;
+    char expected[REPLIES_MAX + 1] = "" ;
+    uint64_t deadline ;
+    bool ok = true, answered ;
+    unsigned int start ;
+    (void)arg ;
+
+    // the startup report and the first prompt
+    sim_sleepUntil(200000000ull) ;
+    for (unsigned int i = 0 ; i < NUM_CASES ; i++) {
+        strcat(expected, cases[i].expected) ;
+        start = numReplies ;
+        sim_uartInject(buf, addLines(buf, cases[i].length, cases[i].count)) ;
+        deadline = sim_nanos() + REPLY_NS ;
+        while (!(answered = (fooReplies() == i + 1)) && sim_nanos() < deadline) {
+            sim_sleepUntil(sim_nanos() + 1000000ull) ;
+        }
+        pthread_mutex_lock(&lock) ;
+        printf("%-20s replies %-6.*s %s\n", cases[i].name, (int)(numReplies - start), replies + start,
+               answered ? "" : "(no reply to foo)") ;
+        pthread_mutex_unlock(&lock) ;
+        if (!answered) break ;
+    }
+    printf("rx overruns          %u\n", getRxOverruns()) ;
+
+    pthread_mutex_lock(&lock) ;
+    replies[numReplies] = '\0' ;
+    ok = strcmp(replies, expected) == 0 ;
+    printf("replies              %s, expected %s: %s\n", replies, expected, ok ? "ok" : "FAIL") ;
+    pthread_mutex_unlock(&lock) ;
+    exit(ok ? 0 : 1) ;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { -1, -1, -1 } ;
+    pthread_t thread ;
+
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]) ;
+        return 2 ;
+    }
+
+    config.uartOut = open("/dev/null", O_WRONLY) ;
+    sim_timeInit() ;
+    sim_txHook = onTx ;
+    sim_start(&config) ;
+    pthread_create(&thread, NULL, driver, NULL) ;
+    return lab4_main() ;
+}
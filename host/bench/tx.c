@@ -0,0 +1,153 @@
+/* ======================================================
+    tx: concurrent senders on the transmit buffer
+
+    Usage: bench_tx [--senders N] [--lines L] [--scale S]
+
+    Runs the firmware in the simulator, with simulated time S
+    times faster than host time (default 1), and N host threads
+    (default 4, at most 8) each sending L lines (default 250)
+    with sendMsgWait at the same time as each other. A line is
+    "#<sender> <sequence> " and letters depending on both, 8 to
+    63 of them. Every line transmitted is checked: a line that
+    differs from the one sent is corrupt, and one whose sequence
+    number is not the next from its sender is out of order.
+
+    Reports the rate, the counts and the transmit statistics,
+    including the longest window in which a sender disabled
+    interrupts. In the simulator that window is host time, so
+    only its order of magnitude means anything; the 'txtest'
+    command reports it on the board.
+    ========================================================= */
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "cmsis_os2.h"
+#include "serialPort.h"
+
+int lab4_main(void) ;
+
+#define SENDERS_MAX (8)
+#define LINE_MAX (80)
+
+static unsigned int senders = 4 ;
+static unsigned int lines = 250 ;
+
+static unsigned int nextSeq[SENDERS_MAX] ;
+static unsigned long received, corrupt, reordered, bytes ;
+static uint64_t start ;
+
+// The line sender sends as its seq'th
+static void makeLine(char *buf, unsigned int sender, unsigned int seq) {
+    int n = sprintf(buf, "#%u %u ", sender, seq) ;
+    unsigned int len = 8 + (seq * 7 + sender) % 56 ;
+
+    for (unsigned int i = 0 ; i < len ; i++) {
+        buf[n + i] = 'a' + (sender * 5 + seq + i) % 26 ;
+    }
+    buf[n + len] = '\0' ;
+}
+
+static void report(void) {
+    TxStats_t stats ;
+    double elapsed = (sim_nanos() - start) / 1e9 ;
+
+    getTxStats(&stats) ;
+    printf("senders            %u x %u lines\n", senders, lines) ;
+    printf("rate               %.0f bytes/s\n", bytes / elapsed) ;
+    printf("lines received     %lu\n", received) ;
+    printf("corrupt            %lu\n", corrupt) ;
+    printf("out of order       %lu\n", reordered) ;
+    printf("high water         %u of %u bytes\n", getTxHighWater(), TXBUFSIZE) ;
+    printf("irqs               %u\n", stats.irqs) ;
+    printf("masked max         %u cycles\n", stats.maskMax) ;
+    exit(0) ;
+}
+
+// Line checker, fed each byte transmitted
+static void onTx(uint8_t c) {
+    static char line[LINE_MAX + 1] ;
+    static unsigned int len ;
+    char expected[LINE_MAX] ;
+    unsigned int sender, seq ;
+
+    if (start != 0) bytes++ ;
+    if (c != '\n') {
+        if (c != '\r' && len < LINE_MAX) line[len++] = c ;
+        return ;
+    }
+    line[len] = '\0' ;
+    len = 0 ;
+    if (line[0] != '#') return ;        // the prompt
+
+    received++ ;
+    if (sscanf(line, "#%u %u ", &sender, &seq) != 2 || sender >= senders) {
+        corrupt++ ;
+    } else {
+        makeLine(expected, sender, seq) ;
+        if (strcmp(line, expected) != 0) corrupt++ ;
+        if (seq != nextSeq[sender]) reordered++ ;
+        nextSeq[sender] = seq + 1 ;
+    }
+    if (received == senders * lines) report() ;
+}
+
+static void *sender(void *arg) {
+    unsigned int id = (unsigned int)(uintptr_t)arg ;
+    char buf[LINE_MAX] ;
+
+    for (unsigned int seq = 0 ; seq < lines ; seq++) {
+        makeLine(buf, id, seq) ;
+        sendMsgWait(buf, CRLF, osWaitForever) ;
+    }
+    return NULL ;
+}
+
+static void *driver(void *arg) {
+    pthread_t threads[SENDERS_MAX] ;
+    (void)arg ;
+
+    // end the prompt's line, then start all senders together
+    sim_sleepUntil(100000000ull) ;
+    sendMsgWait("", CRLF, osWaitForever) ;
+    sim_sleepUntil(200000000ull) ;
+    resetTxStats() ;
+    start = sim_nanos() ;
+    for (unsigned int i = 0 ; i < senders ; i++) {
+        pthread_create(&threads[i], NULL, sender, (void *)(uintptr_t)i) ;
+    }
+    return NULL ;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { -1, -1, -1 } ;
+    uint32_t scale = 1 ;
+    pthread_t thread ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--senders") == 0 && i + 1 < argc) {
+            senders = strtoul(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--lines") == 0 && i + 1 < argc) {
+            lines = strtoul(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = strtoul(argv[++i], NULL, 10) ;
+        } else {
+            fprintf(stderr, "usage: %s [--senders N] [--lines L] [--scale S]\n", argv[0]) ;
+            return 2 ;
+        }
+    }
+    if (senders < 1) senders = 1 ;
+    if (senders > SENDERS_MAX) senders = SENDERS_MAX ;
+    if (lines < 1) lines = 1 ;
+
+    config.uartOut = open("/dev/null", O_WRONLY) ;
+    sim_timeInit() ;
+    sim_setTimeScale(scale) ;
+    sim_txHook = onTx ;
+    sim_start(&config) ;
+    pthread_create(&thread, NULL, driver, NULL) ;
+    return lab4_main() ;
+}
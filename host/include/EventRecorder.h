@@ -0,0 +1,38 @@
+/* ======================================================
+    EventRecorder.h for the host simulation
+
+    The recording calls of the Keil Event Recorder, with the
+    same event ID layout. Records are written to the file given
+    by the simulator's --events option, and can be turned into 
+    a timeline by host/tools/evrdecode.
+    ========================================================= */
+
+#ifndef EVENT_RECORDER_H_
+#define EVENT_RECORDER_H_
+
+#include <stdint.h>
+
+#define EventLevelError   0x00000U
+#define EventLevelAPI     0x10000U
+#define EventLevelOp      0x20000U
+#define EventLevelDetail  0x30000U
+#define EventLevelAll     0x30000U
+
+#define EventRecordNone   0xFFFFFFFFU
+#define EventRecordAll    0xFFFFFFFEU
+
+#define EventID(level, comp_no, msg_no) ((level & EventLevelAll) | ((comp_no & 0xFFU) << 8) | (msg_no & 0xFFU))
+
+uint32_t EventRecorderInitialize (uint32_t recording, uint32_t start) ;
+uint32_t EventRecord2 (uint32_t id, uint32_t val1, uint32_t val2) ;
+
+// Capture file record
+typedef struct {
+    uint64_t ns ;           // simulation time
+    uint32_t id ;
+    uint32_t val1 ;
+    uint32_t val2 ;
+    uint32_t reserved ;
+} EventCapture_t ;
+
+#endif
@@ -0,0 +1,425 @@
+/* ======================================================
+    MKL25Z4.h for the host simulation
+
+    Replaces the device header from the Keil pack when the
+    firmware is built for Linux. Only the peripherals and 
+    fields used by the firmware are declared.
+   
+     * Registers are plain memory in structures with the same 
+       names as the device header
+     * Side effects of register accesses are modelled by the 
+       simulator (host/sim): GPIO set/clear/toggle writes, UART0
+       transmit and receive, DMA channel 0 and SysTick
+     * The CMSIS core intrinsics for the interrupt mask and the 
+       NVIC calls are implemented by the simulator
+    ========================================================= */
+
+#ifndef MKL25Z4_H_
+#define MKL25Z4_H_
+
+#include <stdint.h>
+
+#define __I  volatile const
+#define __O  volatile
+#define __IO volatile
+
+// field helper: value x shifted into field 
+#define SIM_FIELD(x, shift, mask) ((((uint32_t)(x)) << (shift)) & (mask))
+
+/* ----------------------------------------
+     Interrupt numbers
+ * ---------------------------------------- */
+typedef enum {
+    SysTick_IRQn = -1,
+    DMA0_IRQn = 0,
+    DMA1_IRQn = 1,
+    DMA2_IRQn = 2,
+    DMA3_IRQn = 3,
+    UART0_IRQn = 12,
+    TPM0_IRQn = 17,
+    TPM1_IRQn = 18,
+    TPM2_IRQn = 19,
+    LPTMR0_IRQn = 28,
+    PORTA_IRQn = 30,
+    PORTD_IRQn = 31,
+    NUM_IRQn = 32
+} IRQn_Type ;
+
+/* ----------------------------------------
+     CMSIS core: interrupt mask and NVIC
+ * ---------------------------------------- */
+uint32_t __get_PRIMASK(void) ;
+void __set_PRIMASK(uint32_t priMask) ;
+void __disable_irq(void) ;
+void __enable_irq(void) ;
+void __WFI(void) ;
+void __NOP(void) ;
+void __DSB(void) ;
+
+void NVIC_EnableIRQ(IRQn_Type IRQn) ;
+void NVIC_DisableIRQ(IRQn_Type IRQn) ;
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority) ;
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn) ;
+void NVIC_SetPendingIRQ(IRQn_Type IRQn) ;
+
+/* ----------------------------------------
+     SysTick
+       VAL counts down from LOAD at the core clock rate;
+       the simulator updates it on every access
+ * ---------------------------------------- */
+typedef struct {
+    __IO uint32_t CTRL ;
+    __IO uint32_t LOAD ;
+    __IO uint32_t VAL ;
+    __I  uint32_t CALIB ;
+} SysTick_Type ;
+
+SysTick_Type *sim_SysTick(void) ;
+#define SysTick (sim_SysTick())
+
+#define SysTick_CTRL_ENABLE_Msk     (1UL << 0)
+#define SysTick_CTRL_TICKINT_Msk    (1UL << 1)
+#define SysTick_CTRL_CLKSOURCE_Msk  (1UL << 2)
+#define SysTick_CTRL_COUNTFLAG_Msk  (1UL << 16)
+
+/* ----------------------------------------
+     System control block: sleep control only
+ * ---------------------------------------- */
+typedef struct {
+    __IO uint32_t SCR ;
+} SCB_Type ;
+
+extern SCB_Type sim_SCB ;
+#define SCB (&sim_SCB)
+
+#define SCB_SCR_SLEEPDEEP_Msk       (1UL << 2)
+
+/* ----------------------------------------
+     System clock
+ * ---------------------------------------- */
+extern uint32_t SystemCoreClock ;
+void SystemCoreClockUpdate(void) ;
+
+// Oscillators, as in system_MKL25Z4.h
+#define CPU_XTAL_CLK_HZ             8000000u
+#define CPU_INT_SLOW_CLK_HZ         32768u
+#define CPU_INT_FAST_CLK_HZ         4000000u
+
+/* ----------------------------------------
+     SIM - System Integration Module
+ * ---------------------------------------- */
+typedef struct {
+    __IO uint32_t SOPT1 ;
+    __IO uint32_t SOPT2 ;
+    __IO uint32_t SOPT4 ;
+    __IO uint32_t SOPT5 ;
+    __IO uint32_t SOPT7 ;
+    __IO uint32_t SCGC4 ;
+    __IO uint32_t SCGC5 ;
+    __IO uint32_t SCGC6 ;
+    __IO uint32_t SCGC7 ;
+    __IO uint32_t CLKDIV1 ;
+} SIM_Type ;
+
+extern SIM_Type sim_SIM ;
+#define SIM (&sim_SIM)
+
+#define SIM_SCGC4_UART0_MASK        (1UL << 10)
+#define SIM_SCGC5_LPTMR_MASK        (1UL << 0)
+#define SIM_SCGC5_PORTA_MASK        (1UL << 9)
+#define SIM_SCGC5_PORTB_MASK        (1UL << 10)
+#define SIM_SCGC5_PORTC_MASK        (1UL << 11)
+#define SIM_SCGC5_PORTD_MASK        (1UL << 12)
+#define SIM_SCGC5_PORTE_MASK        (1UL << 13)
+#define SIM_SCGC6_DMAMUX_MASK       (1UL << 1)
+#define SIM_SCGC6_TPM0_MASK         (1UL << 24)
+#define SIM_SCGC6_TPM1_MASK         (1UL << 25)
+#define SIM_SCGC6_TPM2_MASK         (1UL << 26)
+#define SIM_SCGC7_DMA_MASK          (1UL << 8)
+#define SIM_SOPT2_PLLFLLSEL_MASK    (1UL << 16)
+#define SIM_SOPT2_TPMSRC_MASK       (3UL << 24)
+#define SIM_SOPT2_TPMSRC(x)         SIM_FIELD(x, 24, SIM_SOPT2_TPMSRC_MASK)
+#define SIM_SOPT2_UART0SRC_MASK     (3UL << 26)
+#define SIM_SOPT2_UART0SRC(x)       SIM_FIELD(x, 26, SIM_SOPT2_UART0SRC_MASK)
+#define SIM_CLKDIV1_OUTDIV1_MASK    (0xFUL << 28)
+#define SIM_CLKDIV1_OUTDIV1_SHIFT   (28)
+
+/* ----------------------------------------
+     PORT - pin control
+ * ---------------------------------------- */
+typedef struct {
+    __IO uint32_t PCR[32] ;
+    __O  uint32_t GPCLR ;
+    __O  uint32_t GPCHR ;
+    __IO uint32_t ISFR ;
+} PORT_Type ;
+
+extern PORT_Type sim_PORTA, sim_PORTB, sim_PORTC, sim_PORTD, sim_PORTE ;
+#define PORTA (&sim_PORTA)
+#define PORTB (&sim_PORTB)
+#define PORTC (&sim_PORTC)
+#define PORTD (&sim_PORTD)
+#define PORTE (&sim_PORTE)
+
+#define PORT_PCR_MUX_MASK           (7UL << 8)
+#define PORT_PCR_MUX(x)             SIM_FIELD(x, 8, PORT_PCR_MUX_MASK)
+#define PORT_PCR_ISF_MASK           (1UL << 24)
+
+/* ----------------------------------------
+     GPIO
+       Writes to PSOR, PCOR and PTOR are applied to PDOR by
+       the simulator when the port is next accessed, or within
+       one UART bit time if it is not
+ * ---------------------------------------- */
+typedef struct {
+    __IO uint32_t PDOR ;
+    __O  uint32_t PSOR ;
+    __O  uint32_t PCOR ;
+    __O  uint32_t PTOR ;
+    __I  uint32_t PDIR ;
+    __IO uint32_t PDDR ;
+} GPIO_Type ;
+
+extern GPIO_Type sim_PTA, sim_PTB, sim_PTC, sim_PTD, sim_PTE ;
+GPIO_Type *sim_GPIO(GPIO_Type *port) ;
+#define PTA (sim_GPIO(&sim_PTA))
+#define PTB (sim_GPIO(&sim_PTB))
+#define PTC (sim_GPIO(&sim_PTC))
+#define PTD (sim_GPIO(&sim_PTD))
+#define PTE (sim_GPIO(&sim_PTE))
+
+// IOPORT aliases: single-cycle access on the device, the same ports here
+typedef GPIO_Type FGPIO_Type ;
+#define FPTA ((FGPIO_Type *)sim_GPIO(&sim_PTA))
+#define FPTB ((FGPIO_Type *)sim_GPIO(&sim_PTB))
+#define FPTC ((FGPIO_Type *)sim_GPIO(&sim_PTC))
+#define FPTD ((FGPIO_Type *)sim_GPIO(&sim_PTD))
+#define FPTE ((FGPIO_Type *)sim_GPIO(&sim_PTE))
+
+/* ----------------------------------------
+     UART0
+ * ---------------------------------------- */
+typedef struct {
+    __IO uint8_t BDH ;
+    __IO uint8_t BDL ;
+    __IO uint8_t C1 ;
+    __IO uint8_t C2 ;
+    __IO uint8_t S1 ;
+    __IO uint8_t S2 ;
+    __IO uint8_t C3 ;
+    __IO uint16_t D ;    // wider than the device so the simulator can detect writes
+    __IO uint8_t MA1 ;
+    __IO uint8_t MA2 ;
+    __IO uint8_t C4 ;
+    __IO uint8_t C5 ;
+} UART0_Type ;
+
+extern UART0_Type sim_UART0 ;
+#define UART0 (&sim_UART0)
+
+#define UART0_BDH_SBR_MASK          (0x1FU)
+#define UART0_BDH_SBR(x)            SIM_FIELD(x, 0, UART0_BDH_SBR_MASK)
+#define UART0_BDH_SBNS(x)           SIM_FIELD(x, 5, 0x20U)
+#define UART0_BDH_RXEDGIE_MASK      (0x40U)
+#define UART0_BDH_RXEDGIE(x)        SIM_FIELD(x, 6, UART0_BDH_RXEDGIE_MASK)
+#define UART0_BDH_LBKDIE(x)         SIM_FIELD(x, 7, 0x80U)
+#define UART0_BDL_SBR(x)            SIM_FIELD(x, 0, 0xFFU)
+
+#define UART0_C1_PE(x)              SIM_FIELD(x, 1, 0x02U)
+#define UART0_C1_M(x)               SIM_FIELD(x, 4, 0x10U)
+#define UART0_C1_LOOPS(x)           SIM_FIELD(x, 7, 0x80U)
+
+#define UART0_C2_RE_MASK            (0x04U)
+#define UART0_C2_RE(x)              SIM_FIELD(x, 2, UART0_C2_RE_MASK)
+#define UART0_C2_TE_MASK            (0x08U)
+#define UART0_C2_TE(x)              SIM_FIELD(x, 3, UART0_C2_TE_MASK)
+#define UART0_C2_RIE_MASK           (0x20U)
+#define UART0_C2_RIE(x)             SIM_FIELD(x, 5, UART0_C2_RIE_MASK)
+#define UART0_C2_TCIE_MASK          (0x40U)
+#define UART0_C2_TCIE(x)            SIM_FIELD(x, 6, UART0_C2_TCIE_MASK)
+#define UART0_C2_TIE_MASK           (0x80U)
+#define UART0_C2_TIE(x)             SIM_FIELD(x, 7, UART0_C2_TIE_MASK)
+
+#define UART0_S1_PF_MASK            (0x01U)
+#define UART0_S1_PF(x)              SIM_FIELD(x, 0, UART0_S1_PF_MASK)
+#define UART0_S1_FE_MASK            (0x02U)
+#define UART0_S1_FE(x)              SIM_FIELD(x, 1, UART0_S1_FE_MASK)
+#define UART0_S1_NF_MASK            (0x04U)
+#define UART0_S1_NF(x)              SIM_FIELD(x, 2, UART0_S1_NF_MASK)
+#define UART0_S1_OR_MASK            (0x08U)
+#define UART0_S1_OR(x)              SIM_FIELD(x, 3, UART0_S1_OR_MASK)
+#define UART0_S1_RDRF_MASK          (0x20U)
+#define UART0_S1_TC_MASK            (0x40U)
+#define UART0_S1_TDRE_MASK          (0x80U)
+
+// the device header also has these under the UART_ prefix
+#define UART_S1_PF_MASK             UART0_S1_PF_MASK
+#define UART_S1_FE_MASK             UART0_S1_FE_MASK
+#define UART_S1_NF_MASK             UART0_S1_NF_MASK
+#define UART_S1_OR_MASK             UART0_S1_OR_MASK
+
+#define UART0_S2_RXEDGIF_MASK       (0x40U)
+#define UART0_S2_RXINV(x)           SIM_FIELD(x, 4, 0x10U)
+#define UART0_S2_MSBF(x)            SIM_FIELD(x, 5, 0x20U)
+
+#define UART0_C3_PEIE(x)            SIM_FIELD(x, 0, 0x01U)
+#define UART0_C3_FEIE(x)            SIM_FIELD(x, 1, 0x02U)
+#define UART0_C3_NEIE(x)            SIM_FIELD(x, 2, 0x04U)
+#define UART0_C3_ORIE(x)            SIM_FIELD(x, 3, 0x08U)
+#define UART0_C3_TXINV(x)           SIM_FIELD(x, 4, 0x10U)
+
+#define UART0_C4_OSR_MASK           (0x1FU)
+#define UART0_C4_OSR(x)             SIM_FIELD(x, 0, UART0_C4_OSR_MASK)
+
+#define UART0_C5_BOTHEDGE_MASK      (0x02U)
+#define UART0_C5_RDMAE_MASK         (0x20U)
+#define UART0_C5_TDMAE_MASK         (0x80U)
+
+/* ----------------------------------------
+     MCG - clock mode and internal reference clock control
+ * ---------------------------------------- */
+typedef struct {
+    __IO uint8_t C1 ;
+    __IO uint8_t C2 ;
+} MCG_Type ;
+
+extern MCG_Type sim_MCG ;
+#define MCG (&sim_MCG)
+
+#define MCG_C1_IREFSTEN_MASK        (0x01U)
+#define MCG_C1_IRCLKEN_MASK         (0x02U)
+#define MCG_C1_IREFS_MASK           (0x04U)
+#define MCG_C1_CLKS_MASK            (0xC0U)
+#define MCG_C1_CLKS_SHIFT           (6)
+#define MCG_C2_IRCS_MASK            (0x01U)
+
+/* ----------------------------------------
+     LPTMR - low power timer
+       registers only: the simulator does not run it
+ * ---------------------------------------- */
+typedef struct {
+    __IO uint32_t CSR ;
+    __IO uint32_t PSR ;
+    __IO uint32_t CMR ;
+    __IO uint32_t CNR ;
+} LPTMR_Type ;
+
+extern LPTMR_Type sim_LPTMR0 ;
+#define LPTMR0 (&sim_LPTMR0)
+
+#define LPTMR_CSR_TEN_MASK          (0x01U)
+#define LPTMR_CSR_TIE_MASK          (0x40U)
+#define LPTMR_CSR_TCF_MASK          (0x80U)
+#define LPTMR_PSR_PCS_MASK          (0x03U)
+#define LPTMR_PSR_PCS(x)            SIM_FIELD(x, 0, LPTMR_PSR_PCS_MASK)
+#define LPTMR_PSR_PBYP_MASK         (0x04U)
+#define LPTMR_PSR_PRESCALE_MASK     (0x78U)
+#define LPTMR_PSR_PRESCALE(x)       SIM_FIELD(x, 3, LPTMR_PSR_PRESCALE_MASK)
+#define LPTMR_CMR_COMPARE_MASK      (0xFFFFU)
+#define LPTMR_CMR_COMPARE(x)        SIM_FIELD(x, 0, LPTMR_CMR_COMPARE_MASK)
+#define LPTMR_CNR_COUNTER_MASK      (0xFFFFU)
+
+/* ----------------------------------------
+     SMC - system mode controller
+ * ---------------------------------------- */
+typedef struct {
+    __IO uint8_t PMPROT ;
+    __IO uint8_t PMCTRL ;
+    __IO uint8_t STOPCTRL ;
+    __I  uint8_t PMSTAT ;
+} SMC_Type ;
+
+extern SMC_Type sim_SMC ;
+#define SMC (&sim_SMC)
+
+#define SMC_PMPROT_AVLP_MASK        (0x20U)
+#define SMC_PMCTRL_STOPM_MASK       (0x07U)
+#define SMC_PMCTRL_STOPM(x)         SIM_FIELD(x, 0, SMC_PMCTRL_STOPM_MASK)
+
+/* ----------------------------------------
+     TPM - timer/PWM module
+       Edge-aligned PWM only. Every use of TPMx in the
+       firmware calls sim_TPM, which applies the writes made
+       since the previous access at the time of that access.
+       CNT is not simulated: the counter starts from 0 when
+       CMOD is set
+ * ---------------------------------------- */
+typedef struct {
+    __IO uint32_t CnSC ;
+    __IO uint32_t CnV ;
+} TPM_Channel_Type ;
+
+typedef struct {
+    __IO uint32_t SC ;
+    __IO uint32_t CNT ;
+    __IO uint32_t MOD ;
+    __IO uint32_t STATUS ;
+    TPM_Channel_Type CONTROLS[6] ;
+    __IO uint32_t CONF ;
+} TPM_Type ;
+
+extern TPM_Type sim_TPM2 ;
+TPM_Type *sim_TPM(TPM_Type *tpm) ;
+#define TPM2 (sim_TPM(&sim_TPM2))
+
+#define TPM_SC_PS_MASK              (0x07U)
+#define TPM_SC_PS(x)                SIM_FIELD(x, 0, TPM_SC_PS_MASK)
+#define TPM_SC_CMOD_MASK            (0x18U)
+#define TPM_SC_CMOD(x)              SIM_FIELD(x, 3, TPM_SC_CMOD_MASK)
+#define TPM_CnSC_ELSA_MASK          (0x04U)
+#define TPM_CnSC_ELSB_MASK          (0x08U)
+#define TPM_CnSC_MSA_MASK           (0x10U)
+#define TPM_CnSC_MSB_MASK           (0x20U)
+
+/* ----------------------------------------
+     DMA controller and DMAMUX
+       SAR and DAR hold host addresses in the simulation
+ * ---------------------------------------- */
+typedef struct {
+    __IO uintptr_t SAR ;
+    __IO uintptr_t DAR ;
+    __IO uint32_t DSR_BCR ;
+    __IO uint32_t DCR ;
+} DMA_Channel_Type ;
+
+typedef struct {
+    DMA_Channel_Type DMA[4] ;
+} DMA_Type ;
+
+extern DMA_Type sim_DMA0 ;
+#define DMA0 (&sim_DMA0)
+
+#define DMA_DSR_BCR_BCR_MASK        (0xFFFFFFUL)
+#define DMA_DSR_BCR_BCR(x)          SIM_FIELD(x, 0, DMA_DSR_BCR_BCR_MASK)
+#define DMA_DSR_BCR_DONE_MASK       (1UL << 24)
+#define DMA_DSR_BCR_BSY_MASK        (1UL << 25)
+#define DMA_DSR_BCR_REQ_MASK        (1UL << 26)
+#define DMA_DSR_BCR_BED_MASK        (1UL << 28)
+#define DMA_DSR_BCR_BES_MASK        (1UL << 29)
+#define DMA_DSR_BCR_CE_MASK         (1UL << 30)
+
+#define DMA_DCR_D_REQ_MASK          (1UL << 7)
+#define DMA_DCR_START_MASK          (1UL << 16)
+#define DMA_DCR_DSIZE_MASK          (3UL << 17)
+#define DMA_DCR_DSIZE(x)            SIM_FIELD(x, 17, DMA_DCR_DSIZE_MASK)
+#define DMA_DCR_DINC_MASK           (1UL << 19)
+#define DMA_DCR_SSIZE_MASK          (3UL << 20)
+#define DMA_DCR_SSIZE(x)            SIM_FIELD(x, 20, DMA_DCR_SSIZE_MASK)
+#define DMA_DCR_SINC_MASK           (1UL << 22)
+#define DMA_DCR_CS_MASK             (1UL << 29)
+#define DMA_DCR_ERQ_MASK            (1UL << 30)
+#define DMA_DCR_EINT_MASK           (1UL << 31)
+
+typedef struct {
+    __IO uint8_t CHCFG[4] ;
+} DMAMUX_Type ;
+
+extern DMAMUX_Type sim_DMAMUX0 ;
+#define DMAMUX0 (&sim_DMAMUX0)
+
+#define DMAMUX_CHCFG_SOURCE_MASK    (0x3FU)
+#define DMAMUX_CHCFG_SOURCE(x)      SIM_FIELD(x, 0, DMAMUX_CHCFG_SOURCE_MASK)
+#define DMAMUX_CHCFG_TRIG_MASK      (0x40U)
+#define DMAMUX_CHCFG_ENBL_MASK      (0x80U)
+
+#endif
@@ -0,0 +1,31 @@
+/* ======================================================
+    rtx_os.h for the host simulation
+
+    The RTX5 control block types used for static allocation,
+    as opaque blocks of the size they have on the target
+    (RTX 5.5, 32-bit pointers), so that RAM budgets computed
+    with sizeof agree with the target build. The simulator
+    does not use the memory.
+    ========================================================= */
+
+#ifndef RTX_OS_H_
+#define RTX_OS_H_
+
+#include <stdint.h>
+#include "cmsis_os2.h"
+
+typedef struct { uint32_t cb[68 / 4] ; } osRtxThread_t ;
+typedef struct { uint32_t cb[32 / 4] ; } osRtxTimer_t ;
+typedef struct { uint32_t cb[16 / 4] ; } osRtxEventFlags_t ;
+typedef struct { uint32_t cb[52 / 4] ; } osRtxMessageQueue_t ;
+
+#define osRtxThreadCbSize           sizeof(osRtxThread_t)
+#define osRtxTimerCbSize            sizeof(osRtxTimer_t)
+#define osRtxEventFlagsCbSize       sizeof(osRtxEventFlags_t)
+#define osRtxMessageQueueCbSize     sizeof(osRtxMessageQueue_t)
+
+// Message queue data: each message has a 12 byte header
+#define osRtxMessageQueueMemSize(msg_count, msg_size) \
+    (4*(msg_count)*(3+(((msg_size)+3)/4)))
+
+#endif
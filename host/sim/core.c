@@ -0,0 +1,511 @@
+/* ======================================================
+    sim core: registers, interrupt mask, SysTick, GPIO and TPM2
+
+    Interrupt model
+      * PRIMASK is a global lock: a thread that disables 
+        interrupts holds it, and simulated interrupt handlers
+        run only while holding it, so a critical region in a 
+        thread excludes the handlers and other critical regions
+      * The mask is tracked per thread, so __get_PRIMASK and
+        __set_PRIMASK nest as they do on the target
+      * A critical region on the target takes microseconds, so 
+        GPIO and TPM2 accesses in one all take the time it began,
+        however long the host thread is descheduled in it
+    ========================================================= */
+
+#include <MKL25Z4.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+#include "gpio.h"
+
+// ================ Clocks ==================
+
+/* --------------------------------
+     Clock profile
+
+    The registers as SystemInit leaves them for CLOCK_SETUP, as
+    in system_MKL25Z4.h: the clocks are not otherwise modelled
+   -------------------------------- */
+#if !defined(CLOCK_SETUP) || (CLOCK_SETUP == 0)
+uint32_t SystemCoreClock = 20971520u ;      // FEI
+#define SIM_SOPT2_INIT (0x01000000U)
+#define SIM_CLKDIV1_INIT (0x00000000U)
+#define MCG_C1_INIT (0x06U)
+#define MCG_C2_INIT (0x24U)
+#elif (CLOCK_SETUP == 1)
+uint32_t SystemCoreClock = 48000000u ;      // PEE
+#define SIM_SOPT2_INIT (0x01010000U)
+#define SIM_CLKDIV1_INIT (0x10010000U)
+#define MCG_C1_INIT (0x1AU)
+#define MCG_C2_INIT (0x24U)
+#elif (CLOCK_SETUP == 2)
+uint32_t SystemCoreClock = 4000000u ;       // BLPI
+#define SIM_SOPT2_INIT (0x02000000U)
+#define SIM_CLKDIV1_INIT (0x00040000U)
+#define MCG_C1_INIT (0x46U)
+#define MCG_C2_INIT (0x27U)
+#else
+#error "CLOCK_SETUP: the simulator supports profiles 0 to 2"
+#endif
+
+// ================ Registers ==================
+
+SIM_Type sim_SIM = { .SOPT2 = SIM_SOPT2_INIT, .CLKDIV1 = SIM_CLKDIV1_INIT } ;
+PORT_Type sim_PORTA, sim_PORTB, sim_PORTC, sim_PORTD, sim_PORTE ;
+GPIO_Type sim_PTA, sim_PTB, sim_PTC, sim_PTD, sim_PTE ;
+UART0_Type sim_UART0 ;
+DMA_Type sim_DMA0 ;
+DMAMUX_Type sim_DMAMUX0 ;
+SCB_Type sim_SCB ;
+MCG_Type sim_MCG = { .C1 = MCG_C1_INIT, .C2 = MCG_C2_INIT } ;
+LPTMR_Type sim_LPTMR0 ;
+SMC_Type sim_SMC ;
+TPM_Type sim_TPM2 ;
+
+static SysTick_Type sysTick ;
+
+void SystemCoreClockUpdate(void) {
+}
+
+// ================ Time ==================
+
+static struct timespec startTime ;
+static uint32_t timeScale = 1 ;
+
+void sim_timeInit(void) {
+    clock_gettime(CLOCK_MONOTONIC, &startTime) ;
+}
+
+void sim_setTimeScale(uint32_t scale) {
+    timeScale = (scale == 0) ? 1 : scale ;
+}
+
+uint32_t sim_timeScale(void) {
+    return timeScale ;
+}
+
+uint64_t sim_nanos(void) {
+    struct timespec now ;
+    clock_gettime(CLOCK_MONOTONIC, &now) ;
+    return ((uint64_t)(now.tv_sec - startTime.tv_sec) * 1000000000u + 
+            now.tv_nsec - startTime.tv_nsec) * timeScale ;
+}
+
+void sim_hostTime(uint64_t ns, struct timespec *t) {
+    ns = ns / timeScale + startTime.tv_nsec ;
+    t->tv_sec = startTime.tv_sec + ns / 1000000000u ;
+    t->tv_nsec = ns % 1000000000u ;
+}
+
+void sim_sleepUntil(uint64_t ns) {
+    struct timespec t ;
+    sim_hostTime(ns, &t) ;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL) != 0) ;
+}
+
+/* --------------------------------
+     SysTick
+
+    Counts down once per core clock from LOAD, reloading on each
+    1 ms kernel tick; VAL is computed from host time on access
+   -------------------------------- */
+SysTick_Type *sim_SysTick(void) {
+    uint64_t ns = sim_nanos() % 1000000u ;
+    uint32_t cycles = (uint32_t)(ns * SystemCoreClock / 1000000000u) ;
+    
+    if (sysTick.LOAD == 0) {
+        sysTick.LOAD = SystemCoreClock / 1000u - 1 ;
+        sysTick.CTRL = SysTick_CTRL_ENABLE_Msk | SysTick_CTRL_TICKINT_Msk | 
+                       SysTick_CTRL_CLKSOURCE_Msk ;
+    }
+    if (cycles > sysTick.LOAD) cycles = sysTick.LOAD ;
+    sysTick.VAL = sysTick.LOAD - cycles ;
+    return &sysTick ;
+}
+
+// ================ Interrupt mask ==================
+
+static void unblocked(bool irq) ;
+
+static pthread_mutex_t irqLock = PTHREAD_MUTEX_INITIALIZER ;
+static __thread uint32_t primask ;
+static __thread uint64_t maskedAt ;     // time the thread took the mask
+static __thread bool inISR ;
+
+uint32_t __get_PRIMASK(void) {
+    return primask ;
+}
+
+void __set_PRIMASK(uint32_t priMask) {
+    if (priMask && !primask) {
+        pthread_mutex_lock(&irqLock) ;
+        maskedAt = sim_nanos() ;
+    } else if (!priMask && primask) {
+        pthread_mutex_unlock(&irqLock) ;
+    }
+    primask = priMask ? 1 : 0 ;
+}
+
+void __disable_irq(void) {
+    __set_PRIMASK(1) ;
+}
+
+void __enable_irq(void) {
+    __set_PRIMASK(0) ;
+}
+
+void __WFI(void) {
+}
+
+void __NOP(void) {
+}
+
+void __DSB(void) {
+}
+
+void sim_irqEnter(void) {
+    pthread_mutex_lock(&irqLock) ;
+    primask = 1 ;
+    inISR = true ;
+    unblocked(true) ;
+}
+
+void sim_irqExit(void) {
+    sim_blocked() ;
+    inISR = false ;
+    primask = 0 ;
+    pthread_mutex_unlock(&irqLock) ;
+}
+
+bool sim_inISR(void) {
+    return inISR ;
+}
+
+// ================ Idle ==================
+
+/* --------------------------------
+     Idle accounting
+
+    Counts the threads that are running (not blocked in a wait)
+    and the interrupt handlers in progress. When the count falls
+    to zero the target would be in its idle thread; when it rises
+    again the target has woken. Idle periods shorter than 
+    HANDOFF_NS of host time are a thread waking another on the 
+    host, not a wakeup, and count as busy.
+   -------------------------------- */
+#define HANDOFF_NS (30000u)
+
+static pthread_mutex_t idleLock = PTHREAD_MUTEX_INITIALIZER ;
+static int busy ;
+static uint64_t idleStart ;
+static SimIdleStats_t idleStats ;
+
+void sim_blocked(void) {
+    pthread_mutex_lock(&idleLock) ;
+    if (--busy == 0) idleStart = sim_nanos() ;
+    pthread_mutex_unlock(&idleLock) ;
+}
+
+// irq: woken by an interrupt
+static void unblocked(bool irq) {
+    uint64_t now ;
+    
+    pthread_mutex_lock(&idleLock) ;
+    if (busy++ == 0 && idleStart != 0) {
+        now = sim_nanos() ;
+        if (now - idleStart >= (uint64_t)HANDOFF_NS * timeScale) {
+            idleStats.wakeups++ ;
+            if (irq) idleStats.irqWakeups++ ;
+            idleStats.idleNs += now - idleStart ;
+        }
+    }
+    pthread_mutex_unlock(&idleLock) ;
+}
+
+void sim_unblocked(void) {
+    unblocked(false) ;
+}
+
+// Includes an idle period in progress
+void sim_getIdleStats(SimIdleStats_t *stats) {
+    pthread_mutex_lock(&idleLock) ;
+    *stats = idleStats ;
+    stats->ns = sim_nanos() ;
+    if (busy == 0 && idleStart != 0) stats->idleNs += stats->ns - idleStart ;
+    pthread_mutex_unlock(&idleLock) ;
+}
+
+// ================ NVIC ==================
+
+static volatile uint32_t nvicEnabled ;
+
+void NVIC_EnableIRQ(IRQn_Type IRQn) {
+    if (IRQn >= 0) __atomic_or_fetch(&nvicEnabled, 1u << IRQn, __ATOMIC_SEQ_CST) ;
+}
+
+void NVIC_DisableIRQ(IRQn_Type IRQn) {
+    if (IRQn >= 0) __atomic_and_fetch(&nvicEnabled, ~(1u << IRQn), __ATOMIC_SEQ_CST) ;
+}
+
+void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority) {
+    (void)IRQn ;
+    (void)priority ;
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn) {
+    (void)IRQn ;
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn) {
+    (void)IRQn ;
+}
+
+bool sim_irqEnabled(int irq) {
+    return (nvicEnabled >> irq) & 1 ;
+}
+
+// ================ GPIO ==================
+
+/* --------------------------------
+     GPIO port access
+
+    Every use of PTx in the firmware calls sim_GPIO, which first
+    applies any set/clear/toggle written by the previous access. 
+    Each register write is therefore seen separately, and is 
+    timestamped with the time of the access that made it.
+   -------------------------------- */
+static pthread_mutex_t gpioLock = PTHREAD_MUTEX_INITIALIZER ;
+static uint64_t accessTime ;
+static unsigned int ledState ;
+
+static void ledTrace(uint64_t ns, unsigned int rgb) ;
+void (*sim_ledHook)(uint64_t ns, unsigned int rgb) = ledTrace ;
+static int traceFd = -1 ;
+
+static void ledTrace(uint64_t ns, unsigned int rgb) {
+    if (traceFd >= 0) {
+        dprintf(traceFd, "LED %12.3f ms %c%c%c\n", ns / 1e6, 
+                (rgb & SIM_RED) ? 'R' : '-', (rgb & SIM_GREEN) ? 'G' : '-', 
+                (rgb & SIM_BLUE) ? 'B' : '-') ;
+    }
+}
+
+/* --------------------------------
+     TPM2 outputs
+
+    The counter runs from MCGIRCLK, the 32768 Hz slow IRC or 
+    the 4 MHz fast IRC, divided by the prescaler. An output with a period under 
+    PWM_STEADY_NS is treated as steady, lit if it is low for any
+    part of the period, rather than traced edge by edge. Edges of
+    slower outputs are computed from the counter and reported 
+    with their own times when the LEDs are next updated.
+
+    Writes while the counter runs with the same SC are buffered,
+    as on the device: the new MOD and CnV values load together
+    when the counter wraps at the end of the period. Stopping the
+    counter (CMOD 0) makes writes take effect at once.
+   -------------------------------- */
+#define PWM_STEADY_NS (20000000ull)
+#define TPM_RED_CH (0)                  // PTB18 alternative 3
+#define TPM_GREEN_CH (1)                // PTB19 alternative 3
+#define MUX_TPM (3)
+
+static TPM_Type tpmWritten ;            // the registers as at the last access
+static TPM_Type tpm ;                   // the configuration in effect
+static bool tpmLoading ;                // buffered writes waiting for the period end
+static uint64_t tpmLoadTime ;
+static uint64_t tpmStart ;              // time the counter started, or last loaded
+static uint64_t tpmChecked ;            // edges reported up to this time
+
+static bool tpmRunning(void) {
+    return (tpm.SC & TPM_SC_CMOD_MASK) != 0 ;
+}
+
+static uint64_t tpmFreq(void) {
+    uint64_t clock = (sim_MCG.C2 & MCG_C2_IRCS_MASK) ? CPU_INT_FAST_CLK_HZ : CPU_INT_SLOW_CLK_HZ ;
+
+    return clock >> (tpm.SC & TPM_SC_PS_MASK) ;
+}
+
+static uint32_t tpmPeriod(void) {
+    return (tpm.MOD & 0xFFFF) + 1 ;
+}
+
+static bool tpmSteady(void) {
+    return tpmPeriod() * 1000000000ull / tpmFreq() < PWM_STEADY_NS ;
+}
+
+// Counts since the counter started, and the time of a count
+static uint64_t tpmCount(uint64_t ns) {
+    return (ns - tpmStart) * tpmFreq() / 1000000000ull ;
+}
+
+static uint64_t tpmTime(uint64_t count) {
+    return tpmStart + (count * 1000000000ull + tpmFreq() - 1) / tpmFreq() ;
+}
+
+// The channel output is low at a counter value: edge-aligned PWM only
+static bool tpmLow(int ch, uint32_t count) {
+    uint32_t mode = tpm.CONTROLS[ch].CnSC & (TPM_CnSC_MSB_MASK | TPM_CnSC_ELSB_MASK | TPM_CnSC_ELSA_MASK) ;
+    uint32_t v = tpm.CONTROLS[ch].CnV & 0xFFFF ;
+    
+    if (mode == (TPM_CnSC_MSB_MASK | TPM_CnSC_ELSB_MASK)) return count >= v ;    // high-true
+    if (mode == (TPM_CnSC_MSB_MASK | TPM_CnSC_ELSA_MASK)) return count < v ;     // low-true
+    return false ;
+}
+
+static bool tpmLit(int ch, uint64_t ns) {
+    if (!tpmRunning()) return false ;
+    if (tpmSteady()) return tpmLow(ch, 0) || tpmLow(ch, tpmPeriod() - 1) ;
+    return tpmLow(ch, tpmCount(ns) % tpmPeriod()) ;
+}
+
+// First edge of either LED channel after a time
+static uint64_t tpmNextEdge(uint64_t ns) {
+    uint32_t period = tpmPeriod() ;
+    uint64_t count = tpmCount(ns) ;
+    uint64_t base = count - count % period ;
+    uint64_t next = base + period ;
+    
+    for (int ch = TPM_RED_CH ; ch <= TPM_GREEN_CH ; ch++) {
+        uint64_t v = tpm.CONTROLS[ch].CnV & 0xFFFF ;
+        if (base + v > count && base + v < next) next = base + v ;
+    }
+    return tpmTime(next) ;
+}
+
+static bool muxTPM(int pin) {
+    return ((sim_PORTB.PCR[pin] & PORT_PCR_MUX_MASK) >> 8) == MUX_TPM ;
+}
+
+// LEDs are lit when the pin is an output driven low, by GPIO or TPM2
+static unsigned int ledsLit(uint64_t ns) {
+    unsigned int rgb = 0 ;
+    uint32_t b = sim_PTB.PDDR & ~sim_PTB.PDOR ;
+    uint32_t d = sim_PTD.PDDR & ~sim_PTD.PDOR ;
+    
+    if (muxTPM(RED_LED_POS) ? tpmLit(TPM_RED_CH, ns) : (b & MASK(RED_LED_POS))) rgb |= SIM_RED ;
+    if (muxTPM(GREEN_LED_POS) ? tpmLit(TPM_GREEN_CH, ns) : (b & MASK(GREEN_LED_POS))) rgb |= SIM_GREEN ;
+    if (d & MASK(BLUE_LED_POS)) rgb |= SIM_BLUE ;
+    return rgb ;
+}
+
+static void report(uint64_t ns) {
+    unsigned int rgb = ledsLit(ns) ;
+    
+    if (rgb != ledState) {
+        ledState = rgb ;
+        sim_ledHook(ns, rgb) ;
+    }
+}
+
+// Report edges of slow outputs up to a time; one at that time only if inclusive
+static void tpmTrace(uint64_t until, bool inclusive) {
+    if (tpmRunning() && !tpmSteady()) {
+        for (uint64_t t = tpmNextEdge(tpmChecked) ; t < until || (inclusive && t == until) ; t = tpmNextEdge(t)) {
+            report(t) ;
+        }
+    }
+    tpmChecked = until ;
+}
+
+// Report TPM2 edges and buffered loads up to a time
+static void tpmEdges(uint64_t until) {
+    if (until <= tpmChecked) return ;
+    if (tpmLoading && tpmLoadTime <= until) {
+        tpmTrace(tpmLoadTime, false) ;
+        tpm = tpmWritten ;
+        tpmStart = tpmLoadTime ;
+        tpmLoading = false ;
+        report(tpmLoadTime) ;
+    }
+    tpmTrace(until, true) ;
+}
+
+// Apply TPM2 writes; true if any took effect at once
+static bool applyTPM(void) {
+    uint64_t count ;
+    
+    if (memcmp((void *)&sim_TPM2, &tpmWritten, sizeof(tpm)) == 0) return false ;
+    memcpy(&tpmWritten, (void *)&sim_TPM2, sizeof(tpm)) ;
+    if (tpmRunning() && tpmWritten.SC == tpm.SC) {
+        count = tpmCount(accessTime) ;
+        tpmLoadTime = tpmTime(count - count % tpmPeriod() + tpmPeriod()) ;
+        if (tpmLoadTime < tpmChecked) tpmLoadTime = tpmChecked ;
+        tpmLoading = true ;
+        return false ;
+    }
+    if ((tpmWritten.SC & TPM_SC_CMOD_MASK) && !tpmRunning()) tpmStart = accessTime ;
+    tpm = tpmWritten ;
+    tpmLoading = false ;
+    return true ;
+}
+
+// Apply writes to one port; true if any
+static bool applyWrites(GPIO_Type *port) {
+    uint32_t set = __atomic_exchange_n(&port->PSOR, 0, __ATOMIC_SEQ_CST) ;
+    uint32_t clr = __atomic_exchange_n(&port->PCOR, 0, __ATOMIC_SEQ_CST) ;
+    uint32_t tog = __atomic_exchange_n(&port->PTOR, 0, __ATOMIC_SEQ_CST) ;
+    
+    if ((set | clr | tog) == 0) return false ;
+    port->PDOR = ((port->PDOR | set) & ~clr) ^ tog ;
+    return true ;
+}
+
+// Time of an access; caller holds gpioLock
+static uint64_t accessNow(void) {
+    uint64_t ns = primask ? maskedAt : sim_nanos() ;
+    
+    return (ns < tpmChecked) ? tpmChecked : ns ;
+}
+
+// Caller holds gpioLock
+//   Writes are applied at the time of the access that made them,
+//   between the TPM2 edges before and after it
+static void flush(void) {
+    bool changed = false ;
+    
+    tpmEdges(accessTime) ;
+    changed |= applyWrites(&sim_PTA) ;
+    changed |= applyWrites(&sim_PTB) ;
+    changed |= applyWrites(&sim_PTC) ;
+    changed |= applyWrites(&sim_PTD) ;
+    changed |= applyWrites(&sim_PTE) ;
+    changed |= applyTPM() ;
+    if (changed) report(accessTime) ;
+    tpmEdges(accessNow()) ;
+}
+
+GPIO_Type *sim_GPIO(GPIO_Type *port) {
+    pthread_mutex_lock(&gpioLock) ;
+    flush() ;
+    accessTime = accessNow() ;
+    pthread_mutex_unlock(&gpioLock) ;
+    return port ;
+}
+
+TPM_Type *sim_TPM(TPM_Type *timer) {
+    pthread_mutex_lock(&gpioLock) ;
+    flush() ;
+    accessTime = accessNow() ;
+    pthread_mutex_unlock(&gpioLock) ;
+    return timer ;
+}
+
+// Masked, so as not to split the writes of a critical region
+void sim_gpioFlush(void) {
+    uint32_t mask = __get_PRIMASK() ;
+    
+    __disable_irq() ;
+    pthread_mutex_lock(&gpioLock) ;
+    flush() ;
+    pthread_mutex_unlock(&gpioLock) ;
+    __set_PRIMASK(mask) ;
+}
+
+void sim_setTraceFd(int fd) {
+    traceFd = fd ;
+}
@@ -0,0 +1,34 @@
+/* ======================================================
+    sim evr: Event Recorder capture
+
+    Each EventRecord2 call appends an EventCapture_t record,
+    stamped with the simulation time, to the capture file
+    ========================================================= */
+
+#include <EventRecorder.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "sim.h"
+
+static pthread_mutex_t captureLock = PTHREAD_MUTEX_INITIALIZER ;
+static int captureFd = -1 ;
+static uint32_t recording ;
+
+void sim_setEventFd(int fd) {
+    captureFd = fd ;
+}
+
+uint32_t EventRecorderInitialize (uint32_t record, uint32_t start) {
+    recording = start ? record : EventRecordNone ;
+    return 1 ;
+}
+
+uint32_t EventRecord2 (uint32_t id, uint32_t val1, uint32_t val2) {
+    EventCapture_t ev = { sim_nanos(), id, val1, val2, 0 } ;
+    
+    if (captureFd < 0 || recording == EventRecordNone) return 0 ;
+    pthread_mutex_lock(&captureLock) ;
+    ssize_t n = write(captureFd, &ev, sizeof(ev)) ;
+    pthread_mutex_unlock(&captureLock) ;
+    return n == sizeof(ev) ;
+}
@@ -0,0 +1,101 @@
+/* ======================================================
+    sim main: run the firmware on the host
+
+    Usage: lab4_sim [--pty] [--trace FILE] [--events FILE] [--time MS] [--scale S]
+
+      --pty         UART0 on a new pseudo-terminal, whose name
+                    is printed; connect a terminal emulator to it.
+                    Otherwise UART0 uses stdin and stdout.
+      --trace FILE  write LED transitions to FILE; default stderr
+      --events FILE write Event Recorder records to FILE, when built
+                    with EVENT_RECORDER; decode with evrdecode
+      --time MS     exit after MS milliseconds
+      --scale S     run simulated time S times faster than host time
+
+    The firmware main (src/main.c) is compiled as lab4_main.
+    ========================================================= */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include "sim.h"
+
+int lab4_main(void) ;
+
+static void usage(const char *name) {
+    fprintf(stderr, "usage: %s [--pty] [--trace FILE] [--events FILE] [--time MS] [--scale S]\n", name) ;
+    exit(2) ;
+}
+
+// Open a pseudo-terminal for UART0; returns the master side
+static int openPty(void) {
+    struct termios raw ;
+    int master = posix_openpt(O_RDWR | O_NOCTTY) ;
+    
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("pty") ;
+        exit(1) ;
+    }
+    // raw mode, and keep the slave open so that the master does not
+    //   see end of file while no terminal is connected
+    int slave = open(ptsname(master), O_RDWR | O_NOCTTY) ;
+    if (slave >= 0 && tcgetattr(slave, &raw) == 0) {
+        cfmakeraw(&raw) ;
+        tcsetattr(slave, TCSANOW, &raw) ;
+    }
+    fprintf(stderr, "UART0 on %s\n", ptsname(master)) ;
+    return master ;
+}
+
+static void *stopAfter(void *arg) {
+    uint64_t ms = (uint64_t)(uintptr_t)arg ;
+    
+    sim_sleepUntil(ms * 1000000u) ;
+    exit(0) ;
+    return NULL ;
+}
+
+int main(int argc, char **argv) {
+    SimConfig_t config = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO } ;
+    unsigned long timeLimit = 0 ;
+    unsigned long scale = 1 ;
+    
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--pty") == 0) {
+            config.uartIn = config.uartOut = openPty() ;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            config.traceFd = open(argv[++i], O_WRONLY | O_CREAT | O_TRUNC, 0644) ;
+            if (config.traceFd < 0) {
+                perror(argv[i]) ;
+                return 1 ;
+            }
+        } else if (strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+            int fd = open(argv[++i], O_WRONLY | O_CREAT | O_TRUNC, 0644) ;
+            if (fd < 0) {
+                perror(argv[i]) ;
+                return 1 ;
+            }
+            sim_setEventFd(fd) ;
+        } else if (strcmp(argv[i], "--time") == 0 && i + 1 < argc) {
+            timeLimit = strtoul(argv[++i], NULL, 10) ;
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = strtoul(argv[++i], NULL, 10) ;
+        } else {
+            usage(argv[0]) ;
+        }
+    }
+    
+    sim_timeInit() ;
+    sim_setTimeScale(scale) ;
+    sim_start(&config) ;
+    if (timeLimit > 0) {
+        pthread_t thread ;
+        pthread_create(&thread, NULL, stopAfter, (void *)(uintptr_t)timeLimit) ;
+    }
+    return lab4_main() ;
+}
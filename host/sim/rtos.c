@@ -0,0 +1,678 @@
+/* ======================================================
+    sim rtos: CMSIS-RTOS2 on POSIX threads
+
+    See host/include/cmsis_os2.h for the differences from RTX.
+
+    Every object has a mutex and a condition variable on the
+    monotonic clock; timeouts in ticks become absolute deadlines
+    on 1 ms tick boundaries. Timers run in a single timer thread,
+    as RTX runs timer callbacks in osRtxTimerThread.
+    ========================================================= */
+
+#include "cmsis_os2.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+
+#define NS_PER_TICK (1000000u)
+#define DEFAULT_STACK (256)         // OS_STACK_SIZE in RTX_Config.h
+
+extern uint32_t SystemCoreClock ;
+
+// ================ Common ==================
+
+static pthread_mutex_t kernelLock = PTHREAD_MUTEX_INITIALIZER ;
+static pthread_cond_t kernelStarted ;
+static osKernelState_t kernelState = osKernelInactive ;
+static int32_t kernelLocked ;
+
+static void initCond(pthread_cond_t *cond) {
+    pthread_condattr_t attr ;
+    pthread_condattr_init(&attr) ;
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC) ;
+    pthread_cond_init(cond, &attr) ;
+    pthread_condattr_destroy(&attr) ;
+}
+
+static uint64_t tickToNs(uint64_t tick) {
+    return tick * NS_PER_TICK ;
+}
+
+// Deadline, in sim_nanos time, for a timeout starting at the current tick
+static uint64_t deadline(uint32_t ticks) {
+    return tickToNs(sim_nanos() / NS_PER_TICK + ticks) ;
+}
+
+// Wait on a condition until a deadline; false on timeout
+static bool waitUntil(pthread_cond_t *cond, pthread_mutex_t *lock, uint32_t timeout, uint64_t due) {
+    struct timespec t ;
+    
+    bool woken ;
+    
+    if (timeout == osWaitForever) {
+        sim_blocked() ;
+        pthread_cond_wait(cond, lock) ;
+        sim_unblocked() ;
+        return true ;
+    }
+    if (due <= sim_nanos()) return false ;
+    sim_hostTime(due, &t) ;
+    sim_blocked() ;
+    woken = pthread_cond_timedwait(cond, lock, &t) != ETIMEDOUT ;
+    sim_unblocked() ;
+    return woken ;
+}
+
+/* --------------------------------
+     Flags wait shared by thread and event flags
+
+    Caller holds lock; returns the flags before clearing, or an error
+   -------------------------------- */
+static uint32_t waitFlags(volatile uint32_t *word, pthread_cond_t *cond, pthread_mutex_t *lock,
+                          uint32_t flags, uint32_t options, uint32_t timeout) {
+    uint64_t due = deadline(timeout) ;
+    uint32_t rflags ;
+    
+    while (1) {
+        rflags = *word ;
+        if ((options & osFlagsWaitAll) ? ((rflags & flags) == flags) : ((rflags & flags) != 0)) {
+            break ;
+        }
+        if (timeout == 0) return osFlagsErrorResource ;
+        if (!waitUntil(cond, lock, timeout, due)) {
+            rflags = *word ;
+            if ((options & osFlagsWaitAll) ? ((rflags & flags) == flags) : ((rflags & flags) != 0)) {
+                break ;
+            }
+            return osFlagsErrorTimeout ;
+        }
+    }
+    if (!(options & osFlagsNoClear)) *word &= ~flags ;
+    return rflags ;
+}
+
+// ================ Kernel ==================
+
+osStatus_t osKernelInitialize (void) {
+    initCond(&kernelStarted) ;
+    kernelState = osKernelReady ;
+    return osOK ;
+}
+
+osStatus_t osKernelGetInfo (osVersion_t *version, char *id_buf, uint32_t id_size) {
+    if (version != NULL) {
+        version->api = 20010003 ;
+        version->kernel = 20010003 ;
+    }
+    if (id_buf != NULL && id_size > 0) {
+        strncpy(id_buf, "RTX host simulation", id_size - 1) ;
+        id_buf[id_size - 1] = 0 ;
+    }
+    return osOK ;
+}
+
+osKernelState_t osKernelGetState (void) {
+    return kernelState ;
+}
+
+static void startTimers(void) ;
+
+osStatus_t osKernelStart (void) {
+    pthread_mutex_lock(&kernelLock) ;
+    kernelState = osKernelRunning ;
+    pthread_cond_broadcast(&kernelStarted) ;
+    pthread_mutex_unlock(&kernelLock) ;
+    startTimers() ;
+    
+    // the main thread takes no further part
+    for (;;) pause() ;
+    return osOK ;
+}
+
+int32_t osKernelLock (void) {
+    int32_t lock = kernelLocked ;
+    kernelLocked = 1 ;
+    return lock ;
+}
+
+int32_t osKernelUnlock (void) {
+    int32_t lock = kernelLocked ;
+    kernelLocked = 0 ;
+    return lock ;
+}
+
+int32_t osKernelRestoreLock (int32_t lock) {
+    kernelLocked = lock ;
+    return lock ;
+}
+
+uint32_t osKernelGetTickCount (void) {
+    return (uint32_t)(sim_nanos() / NS_PER_TICK) ;
+}
+
+uint32_t osKernelGetTickFreq (void) {
+    return 1000000000u / NS_PER_TICK ;
+}
+
+uint32_t osKernelGetSysTimerCount (void) {
+    uint64_t ns = sim_nanos() ;
+    uint64_t ticks = ns / NS_PER_TICK ;
+    return (uint32_t)(ticks * (SystemCoreClock / 1000u) + 
+                      (ns % NS_PER_TICK) * SystemCoreClock / 1000000000u) ;
+}
+
+uint32_t osKernelGetSysTimerFreq (void) {
+    return SystemCoreClock ;
+}
+
+// ================ Threads ==================
+
+typedef struct Thread_s {
+    pthread_t thread ;
+    osThreadFunc_t func ;
+    void *argument ;
+    const char *name ;
+    osPriority_t priority ;
+    uint32_t stackSize ;
+    volatile osThreadState_t state ;
+    pthread_mutex_t lock ;
+    pthread_cond_t cond ;
+    volatile uint32_t flags ;
+    struct Thread_s *next ;
+} Thread_t ;
+
+static Thread_t *threads ;          // all threads, newest first
+static __thread Thread_t *current ;
+
+static void *threadStart(void *arg) {
+    Thread_t *t = arg ;
+    
+    current = t ;
+    pthread_mutex_lock(&kernelLock) ;
+    while (kernelState != osKernelRunning) pthread_cond_wait(&kernelStarted, &kernelLock) ;
+    pthread_mutex_unlock(&kernelLock) ;
+    
+    sim_unblocked() ;
+    t->state = osThreadRunning ;
+    t->func(t->argument) ;
+    t->state = osThreadTerminated ;
+    sim_blocked() ;
+    return NULL ;
+}
+
+osThreadId_t osThreadNew (osThreadFunc_t func, void *argument, const osThreadAttr_t *attr) {
+    Thread_t *t ;
+    
+    if (func == NULL || sim_inISR()) return NULL ;
+    t = calloc(1, sizeof(Thread_t)) ;
+    if (t == NULL) return NULL ;
+    t->func = func ;
+    t->argument = argument ;
+    t->priority = osPriorityNormal ;
+    t->stackSize = DEFAULT_STACK ;
+    if (attr != NULL) {
+        t->name = attr->name ;
+        if (attr->priority != osPriorityNone) t->priority = attr->priority ;
+        if (attr->stack_size != 0) t->stackSize = attr->stack_size ;
+    }
+    t->state = osThreadReady ;
+    pthread_mutex_init(&t->lock, NULL) ;
+    initCond(&t->cond) ;
+    
+    pthread_mutex_lock(&kernelLock) ;
+    t->next = threads ;
+    threads = t ;
+    pthread_mutex_unlock(&kernelLock) ;
+    
+    if (pthread_create(&t->thread, NULL, threadStart, t) != 0) return NULL ;
+    pthread_detach(t->thread) ;
+    return t ;
+}
+
+const char *osThreadGetName (osThreadId_t thread_id) {
+    Thread_t *t = thread_id ;
+    return (t == NULL) ? NULL : t->name ;
+}
+
+osThreadId_t osThreadGetId (void) {
+    return current ;
+}
+
+osThreadState_t osThreadGetState (osThreadId_t thread_id) {
+    Thread_t *t = thread_id ;
+    return (t == NULL) ? osThreadError : t->state ;
+}
+
+uint32_t osThreadGetStackSize (osThreadId_t thread_id) {
+    Thread_t *t = thread_id ;
+    return (t == NULL) ? 0 : t->stackSize ;
+}
+
+// Stack use is not measured on the host
+uint32_t osThreadGetStackSpace (osThreadId_t thread_id) {
+    Thread_t *t = thread_id ;
+    return (t == NULL) ? 0 : t->stackSize ;
+}
+
+osStatus_t osThreadSetPriority (osThreadId_t thread_id, osPriority_t priority) {
+    Thread_t *t = thread_id ;
+    if (t == NULL || priority < osPriorityIdle || priority > osPriorityISR) return osErrorParameter ;
+    t->priority = priority ;
+    return osOK ;
+}
+
+osPriority_t osThreadGetPriority (osThreadId_t thread_id) {
+    Thread_t *t = thread_id ;
+    return (t == NULL) ? osPriorityError : t->priority ;
+}
+
+osStatus_t osThreadYield (void) {
+    sched_yield() ;
+    return osOK ;
+}
+
+void osThreadExit (void) {
+    if (current != NULL) current->state = osThreadTerminated ;
+    pthread_exit(NULL) ;
+}
+
+uint32_t osThreadGetCount (void) {
+    uint32_t count = 0 ;
+    pthread_mutex_lock(&kernelLock) ;
+    for (Thread_t *t = threads ; t != NULL ; t = t->next) {
+        if (t->state != osThreadTerminated) count++ ;
+    }
+    pthread_mutex_unlock(&kernelLock) ;
+    return count ;
+}
+
+uint32_t osThreadEnumerate (osThreadId_t *thread_array, uint32_t array_items) {
+    uint32_t count = 0 ;
+    pthread_mutex_lock(&kernelLock) ;
+    for (Thread_t *t = threads ; t != NULL && count < array_items ; t = t->next) {
+        if (t->state != osThreadTerminated) thread_array[count++] = t ;
+    }
+    pthread_mutex_unlock(&kernelLock) ;
+    return count ;
+}
+
+// ================ Thread flags ==================
+
+uint32_t osThreadFlagsSet (osThreadId_t thread_id, uint32_t flags) {
+    Thread_t *t = thread_id ;
+    uint32_t rflags ;
+    
+    if (t == NULL || (flags & osFlagsError)) return osFlagsErrorParameter ;
+    pthread_mutex_lock(&t->lock) ;
+    t->flags |= flags ;
+    rflags = t->flags ;
+    pthread_cond_broadcast(&t->cond) ;
+    pthread_mutex_unlock(&t->lock) ;
+    return rflags ;
+}
+
+uint32_t osThreadFlagsClear (uint32_t flags) {
+    uint32_t rflags ;
+    
+    if (current == NULL) return osFlagsErrorUnknown ;
+    pthread_mutex_lock(&current->lock) ;
+    rflags = current->flags ;
+    current->flags &= ~flags ;
+    pthread_mutex_unlock(&current->lock) ;
+    return rflags ;
+}
+
+uint32_t osThreadFlagsGet (void) {
+    return (current == NULL) ? 0 : current->flags ;
+}
+
+uint32_t osThreadFlagsWait (uint32_t flags, uint32_t options, uint32_t timeout) {
+    uint32_t rflags ;
+    
+    if (current == NULL || sim_inISR()) return osFlagsErrorISR ;
+    pthread_mutex_lock(&current->lock) ;
+    current->state = osThreadBlocked ;
+    rflags = waitFlags(&current->flags, &current->cond, &current->lock, flags, options, timeout) ;
+    current->state = osThreadRunning ;
+    pthread_mutex_unlock(&current->lock) ;
+    return rflags ;
+}
+
+// ================ Delay ==================
+
+osStatus_t osDelay (uint32_t ticks) {
+    if (sim_inISR()) return osErrorISR ;
+    if (ticks == 0) return osErrorParameter ;
+    sim_blocked() ;
+    sim_sleepUntil(deadline(ticks)) ;
+    sim_unblocked() ;
+    return osOK ;
+}
+
+osStatus_t osDelayUntil (uint32_t ticks) {
+    uint32_t now = osKernelGetTickCount() ;
+    
+    if (sim_inISR()) return osErrorISR ;
+    if ((int32_t)(ticks - now) <= 0) return osErrorParameter ;
+    sim_blocked() ;
+    sim_sleepUntil(tickToNs(sim_nanos() / NS_PER_TICK + (ticks - now))) ;
+    sim_unblocked() ;
+    return osOK ;
+}
+
+// ================ Event flags ==================
+
+typedef struct {
+    const char *name ;
+    pthread_mutex_t lock ;
+    pthread_cond_t cond ;
+    volatile uint32_t flags ;
+} EventFlags_t ;
+
+osEventFlagsId_t osEventFlagsNew (const osEventFlagsAttr_t *attr) {
+    EventFlags_t *ef = calloc(1, sizeof(EventFlags_t)) ;
+    
+    if (ef == NULL) return NULL ;
+    if (attr != NULL) ef->name = attr->name ;
+    pthread_mutex_init(&ef->lock, NULL) ;
+    initCond(&ef->cond) ;
+    return ef ;
+}
+
+uint32_t osEventFlagsSet (osEventFlagsId_t ef_id, uint32_t flags) {
+    EventFlags_t *ef = ef_id ;
+    uint32_t rflags ;
+    
+    if (ef == NULL || (flags & osFlagsError)) return osFlagsErrorParameter ;
+    pthread_mutex_lock(&ef->lock) ;
+    ef->flags |= flags ;
+    rflags = ef->flags ;
+    pthread_cond_broadcast(&ef->cond) ;
+    pthread_mutex_unlock(&ef->lock) ;
+    return rflags ;
+}
+
+uint32_t osEventFlagsClear (osEventFlagsId_t ef_id, uint32_t flags) {
+    EventFlags_t *ef = ef_id ;
+    uint32_t rflags ;
+    
+    if (ef == NULL || (flags & osFlagsError)) return osFlagsErrorParameter ;
+    pthread_mutex_lock(&ef->lock) ;
+    rflags = ef->flags ;
+    ef->flags &= ~flags ;
+    pthread_mutex_unlock(&ef->lock) ;
+    return rflags ;
+}
+
+uint32_t osEventFlagsGet (osEventFlagsId_t ef_id) {
+    EventFlags_t *ef = ef_id ;
+    return (ef == NULL) ? 0 : ef->flags ;
+}
+
+uint32_t osEventFlagsWait (osEventFlagsId_t ef_id, uint32_t flags, uint32_t options, uint32_t timeout) {
+    EventFlags_t *ef = ef_id ;
+    uint32_t rflags ;
+    
+    if (ef == NULL || (flags & osFlagsError)) return osFlagsErrorParameter ;
+    if (sim_inISR() && timeout != 0) return osFlagsErrorParameter ;
+    if (current != NULL) current->state = osThreadBlocked ;
+    pthread_mutex_lock(&ef->lock) ;
+    rflags = waitFlags(&ef->flags, &ef->cond, &ef->lock, flags, options, timeout) ;
+    pthread_mutex_unlock(&ef->lock) ;
+    if (current != NULL) current->state = osThreadRunning ;
+    return rflags ;
+}
+
+// ================ Message queues ==================
+
+typedef struct {
+    const char *name ;
+    pthread_mutex_t lock ;
+    pthread_cond_t notEmpty ;
+    pthread_cond_t notFull ;
+    uint32_t capacity ;         // messages
+    uint32_t size ;             // bytes per message
+    uint32_t head ;             // next message to get
+    uint32_t count ;            // messages held
+    uint8_t *data ;
+} MsgQueue_t ;
+
+osMessageQueueId_t osMessageQueueNew (uint32_t msg_count, uint32_t msg_size, const osMessageQueueAttr_t *attr) {
+    MsgQueue_t *mq ;
+    
+    if (msg_count == 0 || msg_size == 0 || sim_inISR()) return NULL ;
+    mq = calloc(1, sizeof(MsgQueue_t)) ;
+    if (mq == NULL) return NULL ;
+    mq->data = calloc(msg_count, msg_size) ;
+    if (mq->data == NULL) {
+        free(mq) ;
+        return NULL ;
+    }
+    if (attr != NULL) mq->name = attr->name ;
+    mq->capacity = msg_count ;
+    mq->size = msg_size ;
+    pthread_mutex_init(&mq->lock, NULL) ;
+    initCond(&mq->notEmpty) ;
+    initCond(&mq->notFull) ;
+    return mq ;
+}
+
+osStatus_t osMessageQueuePut (osMessageQueueId_t mq_id, const void *msg_ptr, uint8_t msg_prio, uint32_t timeout) {
+    MsgQueue_t *mq = mq_id ;
+    uint64_t due = deadline(timeout) ;
+    (void)msg_prio ;
+    
+    if (mq == NULL || msg_ptr == NULL || (sim_inISR() && timeout != 0)) return osErrorParameter ;
+    pthread_mutex_lock(&mq->lock) ;
+    while (mq->count == mq->capacity) {
+        if (timeout == 0) {
+            pthread_mutex_unlock(&mq->lock) ;
+            return osErrorResource ;
+        }
+        if (!waitUntil(&mq->notFull, &mq->lock, timeout, due) && mq->count == mq->capacity) {
+            pthread_mutex_unlock(&mq->lock) ;
+            return osErrorTimeout ;
+        }
+    }
+    memcpy(&mq->data[((mq->head + mq->count) % mq->capacity) * mq->size], msg_ptr, mq->size) ;
+    mq->count++ ;
+    pthread_cond_signal(&mq->notEmpty) ;
+    pthread_mutex_unlock(&mq->lock) ;
+    return osOK ;
+}
+
+osStatus_t osMessageQueueGet (osMessageQueueId_t mq_id, void *msg_ptr, uint8_t *msg_prio, uint32_t timeout) {
+    MsgQueue_t *mq = mq_id ;
+    uint64_t due = deadline(timeout) ;
+    
+    if (mq == NULL || msg_ptr == NULL || (sim_inISR() && timeout != 0)) return osErrorParameter ;
+    if (current != NULL) current->state = osThreadBlocked ;
+    pthread_mutex_lock(&mq->lock) ;
+    while (mq->count == 0) {
+        if (timeout == 0) {
+            pthread_mutex_unlock(&mq->lock) ;
+            if (current != NULL) current->state = osThreadRunning ;
+            return osErrorResource ;
+        }
+        if (!waitUntil(&mq->notEmpty, &mq->lock, timeout, due) && mq->count == 0) {
+            pthread_mutex_unlock(&mq->lock) ;
+            if (current != NULL) current->state = osThreadRunning ;
+            return osErrorTimeout ;
+        }
+    }
+    memcpy(msg_ptr, &mq->data[mq->head * mq->size], mq->size) ;
+    mq->head = (mq->head + 1) % mq->capacity ;
+    mq->count-- ;
+    if (msg_prio != NULL) *msg_prio = 0 ;
+    pthread_cond_signal(&mq->notFull) ;
+    pthread_mutex_unlock(&mq->lock) ;
+    if (current != NULL) current->state = osThreadRunning ;
+    return osOK ;
+}
+
+uint32_t osMessageQueueGetCapacity (osMessageQueueId_t mq_id) {
+    MsgQueue_t *mq = mq_id ;
+    return (mq == NULL) ? 0 : mq->capacity ;
+}
+
+uint32_t osMessageQueueGetMsgSize (osMessageQueueId_t mq_id) {
+    MsgQueue_t *mq = mq_id ;
+    return (mq == NULL) ? 0 : mq->size ;
+}
+
+uint32_t osMessageQueueGetCount (osMessageQueueId_t mq_id) {
+    MsgQueue_t *mq = mq_id ;
+    return (mq == NULL) ? 0 : mq->count ;
+}
+
+uint32_t osMessageQueueGetSpace (osMessageQueueId_t mq_id) {
+    MsgQueue_t *mq = mq_id ;
+    return (mq == NULL) ? 0 : mq->capacity - mq->count ;
+}
+
+osStatus_t osMessageQueueReset (osMessageQueueId_t mq_id) {
+    MsgQueue_t *mq = mq_id ;
+    
+    if (mq == NULL) return osErrorParameter ;
+    pthread_mutex_lock(&mq->lock) ;
+    mq->head = 0 ;
+    mq->count = 0 ;
+    pthread_cond_broadcast(&mq->notFull) ;
+    pthread_mutex_unlock(&mq->lock) ;
+    return osOK ;
+}
+
+// ================ Timers ==================
+
+typedef struct Timer_s {
+    const char *name ;
+    osTimerFunc_t func ;
+    void *argument ;
+    osTimerType_t type ;
+    bool running ;
+    bool deleted ;
+    uint32_t period ;           // ticks
+    uint64_t due ;              // tick at which the timer next expires
+    struct Timer_s *next ;
+} Timer_t ;
+
+static pthread_mutex_t timerLock = PTHREAD_MUTEX_INITIALIZER ;
+static pthread_cond_t timerChanged ;
+static Timer_t *timers ;
+static bool timersStarted ;
+
+static void *timerThread(void *arg) {
+    (void)arg ;
+    
+    sim_unblocked() ;
+    pthread_mutex_lock(&timerLock) ;
+    while (1) {
+        Timer_t *first = NULL ;
+        for (Timer_t *t = timers ; t != NULL ; t = t->next) {
+            if (t->running && (first == NULL || t->due < first->due)) first = t ;
+        }
+        if (first == NULL) {
+            waitUntil(&timerChanged, &timerLock, osWaitForever, 0) ;
+            continue ;
+        }
+        if (sim_nanos() < tickToNs(first->due)) {
+            waitUntil(&timerChanged, &timerLock, 0, tickToNs(first->due)) ;
+            continue ;
+        }
+        if (first->type == osTimerPeriodic) {
+            first->due += first->period ;
+        } else {
+            first->running = false ;
+        }
+        pthread_mutex_unlock(&timerLock) ;
+        first->func(first->argument) ;
+        pthread_mutex_lock(&timerLock) ;
+    }
+    return NULL ;
+}
+
+static void startTimers(void) {
+    pthread_t thread ;
+    
+    pthread_mutex_lock(&timerLock) ;
+    if (!timersStarted) {
+        timersStarted = true ;
+        initCond(&timerChanged) ;
+        pthread_create(&thread, NULL, timerThread, NULL) ;
+    }
+    pthread_mutex_unlock(&timerLock) ;
+}
+
+osTimerId_t osTimerNew (osTimerFunc_t func, osTimerType_t type, void *argument, const osTimerAttr_t *attr) {
+    Timer_t *t ;
+    
+    if (func == NULL || sim_inISR()) return NULL ;
+    t = calloc(1, sizeof(Timer_t)) ;
+    if (t == NULL) return NULL ;
+    t->func = func ;
+    t->type = type ;
+    t->argument = argument ;
+    if (attr != NULL) t->name = attr->name ;
+    
+    pthread_mutex_lock(&timerLock) ;
+    t->next = timers ;
+    timers = t ;
+    pthread_mutex_unlock(&timerLock) ;
+    return t ;
+}
+
+const char *osTimerGetName (osTimerId_t timer_id) {
+    Timer_t *t = timer_id ;
+    return (t == NULL) ? NULL : t->name ;
+}
+
+osStatus_t osTimerStart (osTimerId_t timer_id, uint32_t ticks) {
+    Timer_t *t = timer_id ;
+    
+    if (t == NULL || ticks == 0 || t->deleted) return osErrorParameter ;
+    if (sim_inISR()) return osErrorISR ;
+    pthread_mutex_lock(&timerLock) ;
+    t->period = ticks ;
+    t->due = sim_nanos() / NS_PER_TICK + ticks ;
+    t->running = true ;
+    if (timersStarted) pthread_cond_signal(&timerChanged) ;
+    pthread_mutex_unlock(&timerLock) ;
+    return osOK ;
+}
+
+osStatus_t osTimerStop (osTimerId_t timer_id) {
+    Timer_t *t = timer_id ;
+    osStatus_t status = osOK ;
+    
+    if (t == NULL || t->deleted) return osErrorParameter ;
+    if (sim_inISR()) return osErrorISR ;
+    pthread_mutex_lock(&timerLock) ;
+    if (!t->running) status = osErrorResource ;
+    t->running = false ;
+    if (timersStarted) pthread_cond_signal(&timerChanged) ;
+    pthread_mutex_unlock(&timerLock) ;
+    return status ;
+}
+
+uint32_t osTimerIsRunning (osTimerId_t timer_id) {
+    Timer_t *t = timer_id ;
+    return (t == NULL) ? 0 : t->running ;
+}
+
+// The control block is kept, as a callback may still be using it
+osStatus_t osTimerDelete (osTimerId_t timer_id) {
+    Timer_t *t = timer_id ;
+    
+    if (t == NULL || t->deleted) return osErrorParameter ;
+    if (sim_inISR()) return osErrorISR ;
+    pthread_mutex_lock(&timerLock) ;
+    t->running = false ;
+    t->deleted = true ;
+    pthread_mutex_unlock(&timerLock) ;
+    return osOK ;
+}
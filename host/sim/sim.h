@@ -0,0 +1,88 @@
+/* ======================================================
+    sim: host simulation of the KL25Z peripherals
+
+    Internal interface shared by the simulator modules and
+    the host tools built on them
+    ========================================================= */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Host time since the simulation started, in ns
+uint64_t sim_nanos(void) ;
+
+// Sleep until an absolute sim_nanos time
+void sim_sleepUntil(uint64_t ns) ;
+
+// Host monotonic clock time of a sim_nanos time
+struct timespec ;
+void sim_hostTime(uint64_t ns, struct timespec *t) ;
+
+// Run simulated time faster than host time, for long runs
+void sim_setTimeScale(uint32_t scale) ;
+uint32_t sim_timeScale(void) ;
+
+// Run code as an interrupt handler: waits while interrupts are masked
+void sim_irqEnter(void) ;
+void sim_irqExit(void) ;
+bool sim_inISR(void) ;
+bool sim_irqEnabled(int irq) ;
+
+// Idle accounting: threads call these around each blocking wait
+void sim_blocked(void) ;
+void sim_unblocked(void) ;
+
+typedef struct {
+    uint64_t ns ;           // simulated time
+    uint64_t idleNs ;       // time with every thread blocked
+    uint32_t wakeups ;      // idle periods ended
+    uint32_t irqWakeups ;   // of which by an interrupt handler
+} SimIdleStats_t ;
+
+void sim_getIdleStats(SimIdleStats_t *stats) ;
+
+// LED state: bits set for LEDs lit
+#define SIM_RED (0x1)
+#define SIM_GREEN (0x2)
+#define SIM_BLUE (0x4)
+
+// Called with each change in the LED state; default prints a trace line
+extern void (*sim_ledHook)(uint64_t ns, unsigned int rgb) ;
+
+// Called with each byte transmitted on UART0; default writes it out
+extern void (*sim_txHook)(uint8_t c) ;
+
+// Queue bytes to be received on UART0, ahead of the input stream
+void sim_uartInject(const char *bytes, int count) ;
+
+// Injected bytes not yet received
+unsigned int sim_uartInjectPending(void) ;
+
+// The baud rate of the host's serial port; 0 (the default) follows
+//   UART0 exactly. Otherwise each byte is sampled by the receiver
+//   at its own rate, and lost if the stop bit is sampled low
+void sim_uartHostBaud(uint32_t baud) ;
+
+// Configuration, set before sim_start
+typedef struct {
+    int uartIn ;            // file descriptor read for UART0 receive; -1 for none
+    int uartOut ;           // file descriptor written by UART0 transmit
+    int traceFd ;           // LED trace; -1 for none
+} SimConfig_t ;
+
+void sim_start(const SimConfig_t *config) ;
+
+// Apply pending GPIO writes; called by the peripheral thread 
+void sim_gpioFlush(void) ;
+void sim_setTraceFd(int fd) ;
+
+// Event Recorder capture file; -1 for none
+void sim_setEventFd(int fd) ;
+
+// Time base for SysTick and the kernel tick 
+void sim_timeInit(void) ;
+
+#endif
@@ -0,0 +1,263 @@
+/* ======================================================
+    sim uart: UART0 and DMA channel 0
+
+    A peripheral thread steps once per character time at the
+    baud rate programmed in UART0 (from SBR, OSR and the core
+    clock), or less often while idle. In each step it
+      * transmits one byte: from DMA channel 0 when it is routed
+        to UART0 transmit, otherwise by running the UART0 handler
+        with TDRE set while TIE is enabled
+      * receives one byte, if available, by running the UART0 
+        handler with RDRF set and the byte in D
+      * applies pending GPIO writes
+
+    With sim_uartHostBaud set, a byte sent either way is decoded
+    as the receiver would: each bit sampled at the middle of its
+    time at the receiver's rate, from the start edge.
+    ========================================================= */
+
+#include <MKL25Z4.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include "sim.h"
+
+void UART0_IRQHandler(void) ;
+void DMA0_IRQHandler(void) ;
+
+#define DNONE (0x8000)              // D value meaning nothing written: not a
+                                    // byte, even a sign-extended char
+#define S1ERRORS (UART0_S1_OR_MASK | UART0_S1_NF_MASK | UART0_S1_FE_MASK | UART0_S1_PF_MASK)
+#define DMAMUX_UART0_TX (3)
+
+static SimConfig_t config ;
+
+static void txWrite(uint8_t c) ;
+void (*sim_txHook)(uint8_t c) = txWrite ;
+
+static void txWrite(uint8_t c) {
+    while (write(config.uartOut, &c, 1) < 0 && errno == EINTR) ;
+}
+
+static volatile uint32_t hostBaud ;     // 0: as UART0
+
+void sim_uartHostBaud(uint32_t baud) {
+    hostBaud = baud ;
+}
+
+// Bytes injected ahead of the input stream
+#define INJECTSIZE (4096)
+static pthread_mutex_t injectLock = PTHREAD_MUTEX_INITIALIZER ;
+static char injected[INJECTSIZE] ;
+static unsigned int injectHead, injectTail ;
+
+void sim_uartInject(const char *bytes, int count) {
+    pthread_mutex_lock(&injectLock) ;
+    while (count-- > 0 && injectTail - injectHead < INJECTSIZE) {
+        injected[injectTail++ % INJECTSIZE] = *bytes++ ;
+    }
+    pthread_mutex_unlock(&injectLock) ;
+}
+
+unsigned int sim_uartInjectPending(void) {
+    unsigned int pending ;
+    
+    pthread_mutex_lock(&injectLock) ;
+    pending = injectTail - injectHead ;
+    pthread_mutex_unlock(&injectLock) ;
+    return pending ;
+}
+
+// Next received byte; false if none available
+static bool rxByte(uint8_t *c) {
+    bool ok = false ;
+    
+    pthread_mutex_lock(&injectLock) ;
+    if (injectHead != injectTail) {
+        *c = injected[injectHead++ % INJECTSIZE] ;
+        ok = true ;
+    }
+    pthread_mutex_unlock(&injectLock) ;
+    if (ok) return true ;
+    
+    if (config.uartIn < 0) return false ;
+    if (read(config.uartIn, c, 1) == 1) return true ;
+    if (errno != EAGAIN && errno != EINTR) config.uartIn = -1 ;  // EOF or error
+    return false ;
+}
+
+// UART0 clock, Hz, selected by SOPT2: 0 when disabled
+static uint64_t uartClock(void) {
+    uint64_t mcgOut = (uint64_t)SystemCoreClock *
+        (((sim_SIM.CLKDIV1 & SIM_CLKDIV1_OUTDIV1_MASK) >> SIM_CLKDIV1_OUTDIV1_SHIFT) + 1) ;
+
+    switch ((sim_SIM.SOPT2 & SIM_SOPT2_UART0SRC_MASK) >> 26) {
+    case 1:     // MCGFLLCLK or MCGPLLCLK / 2
+        return (sim_SIM.SOPT2 & SIM_SOPT2_PLLFLLSEL_MASK) ? mcgOut / 2 : mcgOut ;
+    case 2:     // OSCERCLK
+        return CPU_XTAL_CLK_HZ ;
+    case 3:     // MCGIRCLK
+        return (sim_MCG.C2 & MCG_C2_IRCS_MASK) ? CPU_INT_FAST_CLK_HZ : CPU_INT_SLOW_CLK_HZ ;
+    }
+    return 0 ;
+}
+
+// UART0 baud rate; 0 if not configured
+static double uartBaud(void) {
+    uint32_t sbr = ((sim_UART0.BDH & UART0_BDH_SBR_MASK) << 8) | sim_UART0.BDL ;
+    uint32_t osr = (sim_UART0.C4 & UART0_C4_OSR_MASK) + 1 ;
+    uint64_t clock = uartClock() ;
+    
+    if (sbr == 0 || osr < 4 || clock == 0) return 0 ;
+    return (double)clock / ((double)sbr * osr) ;
+}
+
+// Character time in ns: start + 8 data + stop bits
+static uint64_t charTime(void) {
+    double baud = uartBaud() ;
+    
+    if (baud == 0) return 1000000 ;     // not configured
+    return (uint64_t)(10e9 / baud) ;
+}
+
+/* --------------------------------
+     A byte sent at one baud rate and received at another
+
+    Bit k of the frame (start, 8 data LSB first, stop) is sampled
+    (k + 0.5) receiver bit times after the start edge; past the 
+    stop bit the line is idle, high. False if the start bit is 
+    not sampled low or the stop bit high: the byte is lost.
+   -------------------------------- */
+static bool resample(uint8_t *c, double sendBaud, double receiveBaud) {
+    uint32_t frame = ((uint32_t)*c << 1) | (1u << 9) ;
+    uint32_t bits = 0 ;
+    
+    if (sendBaud == 0 || receiveBaud == 0 || sendBaud == receiveBaud) return true ;
+    for (int k = 0 ; k < 10 ; k++) {
+        int sent = (int)((k + 0.5) * sendBaud / receiveBaud) ;
+        if (sent > 9 || (frame & (1u << sent))) bits |= 1u << k ;
+    }
+    if ((bits & 1) || !(bits & (1u << 9))) return false ;
+    *c = (uint8_t)(bits >> 1) ;
+    return true ;
+}
+
+// A byte transmitted by UART0, as the host receives it
+static void hostRx(uint8_t c) {
+    if (hostBaud == 0 || resample(&c, uartBaud(), hostBaud)) sim_txHook(c) ;
+}
+
+// DMA channel 0 is routed to, and enabled for, UART0 transmit 
+static bool dmaActive(void) {
+    DMA_Channel_Type *ch = &sim_DMA0.DMA[0] ;
+    
+    return (sim_UART0.C5 & UART0_C5_TDMAE_MASK) &&
+           (sim_DMAMUX0.CHCFG[0] & DMAMUX_CHCFG_ENBL_MASK) &&
+           (sim_DMAMUX0.CHCFG[0] & DMAMUX_CHCFG_SOURCE_MASK) == DMAMUX_UART0_TX &&
+           (ch->DCR & DMA_DCR_ERQ_MASK) &&
+           (ch->DSR_BCR & DMA_DSR_BCR_BCR_MASK) != 0 ;
+}
+
+// One byte moved by DMA channel 0
+static void dmaStep(void) {
+    DMA_Channel_Type *ch = &sim_DMA0.DMA[0] ;
+    uint32_t bcr = (ch->DSR_BCR & DMA_DSR_BCR_BCR_MASK) - 1 ;
+    
+    hostRx(*(uint8_t *)ch->SAR) ;
+    if (ch->DCR & DMA_DCR_SINC_MASK) ch->SAR++ ;
+    ch->DSR_BCR = (ch->DSR_BCR & ~DMA_DSR_BCR_BCR_MASK) | bcr ;
+    if (bcr != 0) return ;
+    
+    ch->DSR_BCR |= DMA_DSR_BCR_DONE_MASK ;
+    if (ch->DCR & DMA_DCR_D_REQ_MASK) ch->DCR &= ~DMA_DCR_ERQ_MASK ;
+    if ((ch->DCR & DMA_DCR_EINT_MASK) && sim_irqEnabled(DMA0_IRQn)) {
+        DMA0_IRQHandler() ;
+    }
+}
+
+// One byte sent by the UART0 handler, if it has one
+//   Error flags are write-1-to-clear on the device; no errors are simulated
+static bool uartTxStep(void) {
+    sim_UART0.S1 = (sim_UART0.S1 & ~S1ERRORS) | UART0_S1_TDRE_MASK ;
+    sim_UART0.D = DNONE ;
+    UART0_IRQHandler() ;
+    if (sim_UART0.D == DNONE) return false ;
+    hostRx((uint8_t)sim_UART0.D) ;
+    sim_UART0.D = DNONE ;
+    return true ;
+}
+
+static void uartRxStep(uint8_t c) {
+    sim_UART0.D = c ;
+    sim_UART0.S1 = (sim_UART0.S1 & ~S1ERRORS & ~UART0_S1_TDRE_MASK) |  // RX only in this call
+                   UART0_S1_RDRF_MASK ;
+    UART0_IRQHandler() ;
+    sim_UART0.S1 &= ~UART0_S1_RDRF_MASK ;
+    sim_UART0.S1 |= UART0_S1_TDRE_MASK ;
+    sim_UART0.D = DNONE ;
+}
+
+// While idle, step at least this often in host time
+#define IDLE_STEP_NS (50000u)
+
+static void *peripheralThread(void *arg) {
+    uint64_t next = sim_nanos() ;
+    uint64_t step = 0 ;
+    bool sent ;
+    uint8_t c ;
+    (void)arg ;
+    
+    while (1) {
+        next += step ;
+        sim_sleepUntil(next) ;
+        step = (uint64_t)IDLE_STEP_NS * sim_timeScale() ;
+        
+        sent = false ;
+        if (sim_UART0.C2 & UART0_C2_TE_MASK) {
+            if (dmaActive()) {
+                sim_irqEnter() ;
+                dmaStep() ;
+                sim_irqExit() ;
+                sent = true ;
+                step = charTime() ;
+            } else if ((sim_UART0.C2 & UART0_C2_TIE_MASK) && sim_irqEnabled(UART0_IRQn)) {
+                sim_irqEnter() ;
+                sent = uartTxStep() ;
+                sim_irqExit() ;
+                step = charTime() ;
+            }
+        }
+        // TC: clear while a byte is shifted out, for its character time
+        if (sent) {
+            sim_UART0.S1 &= ~UART0_S1_TC_MASK ;
+        } else {
+            sim_UART0.S1 |= UART0_S1_TC_MASK ;
+        }
+        if ((sim_UART0.C2 & UART0_C2_RE_MASK) && (sim_UART0.C2 & UART0_C2_RIE_MASK) &&
+            sim_irqEnabled(UART0_IRQn) && rxByte(&c) &&
+            (hostBaud == 0 || resample(&c, hostBaud, uartBaud()))) {
+            sim_irqEnter() ;
+            uartRxStep(c) ;
+            sim_irqExit() ;
+            step = charTime() ;
+        }
+        if (step < charTime()) step = charTime() ;
+        sim_gpioFlush() ;
+    }
+    return NULL ;
+}
+
+void sim_start(const SimConfig_t *cfg) {
+    pthread_t thread ;
+    
+    config = *cfg ;
+    if (config.uartIn >= 0) {
+        fcntl(config.uartIn, F_SETFL, fcntl(config.uartIn, F_GETFL) | O_NONBLOCK) ;
+    }
+    sim_setTraceFd(config.traceFd) ;
+    sim_UART0.S1 = UART0_S1_TDRE_MASK | UART0_S1_TC_MASK ;
+    sim_UART0.D = DNONE ;
+    pthread_create(&thread, NULL, peripheralThread, NULL) ;
+}
@@ -0,0 +1,198 @@
+/* ======================================================
+    evrdecode: Event Recorder capture to timeline
+
+    Usage: evrdecode [--scvd FILE] CAPTURE
+
+    Reads the EventCapture_t records written by lab4_sim --events
+    and the event descriptions in lab4.scvd (default the one in the
+    source tree, SCVD_PATH, or --scvd), then prints
+
+      * a timeline: time, time since the previous event, event 
+        name and values formatted as in the .scvd
+      * for each kind of event, the latency from the most recent 
+        received line end (Serial.RxEnqueue) to its first occurrence
+        after it: the stages of the command to LED change path
+    ========================================================= */
+
+#include <EventRecorder.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// set by the build to the source tree's lab4.scvd
+#ifndef SCVD_PATH
+#define SCVD_PATH "../lab4.scvd"
+#endif
+
+#define MAXEVENTS (64)
+#define MAXCOMPONENTS (16)
+#define RXLINE (0x0402)             // Serial.RxEnqueue
+
+typedef struct {
+    unsigned int id ;               // component << 8 | message
+    char name[40] ;
+    char value[120] ;
+    // latency from the last RxEnqueue
+    uint32_t count ;
+    uint64_t min, max, total ;
+    bool seen ;                     // since the last RxEnqueue
+} EventDesc_t ;
+
+typedef struct {
+    unsigned int no ;
+    char name[24] ;
+} Component_t ;
+
+static EventDesc_t events[MAXEVENTS] ;
+static int numEvents ;
+static Component_t components[MAXCOMPONENTS] ;
+static int numComponents ;
+
+// Copy the value of attribute attr in tag into buf; false if absent
+static bool attribute(const char *tag, const char *attr, char *buf, size_t size) {
+    char key[32] ;
+    const char *p, *end ;
+    
+    snprintf(key, sizeof(key), " %s=\"", attr) ;
+    p = strstr(tag, key) ;
+    if (p == NULL) return false ;
+    p += strlen(key) ;
+    end = strchr(p, '"') ;
+    if (end == NULL || (size_t)(end - p) >= size) return false ;
+    memcpy(buf, p, end - p) ;
+    buf[end - p] = 0 ;
+    return true ;
+}
+
+static const char *componentName(unsigned int no) {
+    for (int i = 0 ; i < numComponents ; i++) {
+        if (components[i].no == no) return components[i].name ;
+    }
+    return "?" ;
+}
+
+// Read <component> and <event> tags; one tag per line
+static bool readScvd(const char *path) {
+    char line[512], buf[120] ;
+    FILE *f = fopen(path, "r") ;
+    
+    if (f == NULL) return false ;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *tag ;
+        if ((tag = strstr(line, "<component ")) != NULL && numComponents < MAXCOMPONENTS) {
+            if (!attribute(tag, "no", buf, sizeof(buf))) continue ;
+            components[numComponents].no = strtoul(buf, NULL, 0) ;
+            attribute(tag, "name", components[numComponents].name, sizeof(components[0].name)) ;
+            numComponents++ ;
+        } else if ((tag = strstr(line, "<event ")) != NULL && numEvents < MAXEVENTS) {
+            EventDesc_t *e = &events[numEvents] ;
+            char property[24] = "" ;
+            if (!attribute(tag, "id", buf, sizeof(buf))) continue ;
+            e->id = strtoul(buf, NULL, 0) ;
+            attribute(tag, "property", property, sizeof(property)) ;
+            attribute(tag, "value", e->value, sizeof(e->value)) ;
+            snprintf(e->name, sizeof(e->name), "%s.%s", componentName(e->id >> 8), property) ;
+            numEvents++ ;
+        }
+    }
+    fclose(f) ;
+    return true ;
+}
+
+static EventDesc_t *findEvent(unsigned int id) {
+    for (int i = 0 ; i < numEvents ; i++) {
+        if (events[i].id == id) return &events[i] ;
+    }
+    return NULL ;
+}
+
+// Format an .scvd value string: %d[valN], %u[valN], %x[valN]
+static void format(const char *value, const EventCapture_t *ev, char *out, size_t size) {
+    size_t n = 0 ;
+    
+    while (*value && n + 12 < size) {
+        if (value[0] == '%' && value[1] && value[2] == '[' && strncmp(value + 3, "val", 3) == 0) {
+            uint32_t v = (value[6] == '1') ? ev->val1 : ev->val2 ;
+            const char *end = strchr(value, ']') ;
+            if (end == NULL) break ;
+            n += snprintf(out + n, size - n, (value[1] == 'x') ? "0x%x" : 
+                          (value[1] == 'd') ? "%d" : "%u", v) ;
+            value = end + 1 ;
+        } else {
+            out[n++] = *value++ ;
+        }
+    }
+    out[n] = 0 ;
+}
+
+int main(int argc, char **argv) {
+    const char *scvd = SCVD_PATH ;
+    const char *capture = NULL ;
+    EventCapture_t ev ;
+    uint64_t prev = 0, rxLine = 0 ;
+    bool haveRx = false ;
+    char text[200] ;
+    FILE *f ;
+    
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--scvd") == 0 && i + 1 < argc) {
+            scvd = argv[++i] ;
+        } else {
+            capture = argv[i] ;
+        }
+    }
+    if (capture == NULL) {
+        fprintf(stderr, "usage: %s [--scvd FILE] CAPTURE\n", argv[0]) ;
+        return 2 ;
+    }
+    if (!readScvd(scvd)) {
+        fprintf(stderr, "cannot read %s\n", scvd) ;
+        return 1 ;
+    }
+    f = fopen(capture, "rb") ;
+    if (f == NULL) {
+        perror(capture) ;
+        return 1 ;
+    }
+    
+    printf("%12s %10s  %-20s %s\n", "time ms", "+us", "event", "values") ;
+    while (fread(&ev, sizeof(ev), 1, f) == 1) {
+        EventDesc_t *e = findEvent(ev.id & 0xFFFF) ;
+        
+        if (e != NULL) {
+            format(e->value, &ev, text, sizeof(text)) ;
+            printf("%12.3f %10.1f  %-20s %s\n", ev.ns / 1e6, (ev.ns - prev) / 1e3, e->name, text) ;
+        } else {
+            printf("%12.3f %10.1f  0x%04x               %u %u\n", ev.ns / 1e6, (ev.ns - prev) / 1e3, 
+                   ev.id & 0xFFFF, ev.val1, ev.val2) ;
+        }
+        prev = ev.ns ;
+        if (e == NULL) continue ;
+        
+        // latency of the path from a received line 
+        if (e->id == RXLINE) {
+            rxLine = ev.ns ;
+            haveRx = true ;
+            for (int i = 0 ; i < numEvents ; i++) events[i].seen = false ;
+        } else if (haveRx && !e->seen) {
+            uint64_t latency = ev.ns - rxLine ;
+            e->seen = true ;
+            if (e->count == 0 || latency < e->min) e->min = latency ;
+            if (latency > e->max) e->max = latency ;
+            e->total += latency ;
+            e->count++ ;
+        }
+    }
+    fclose(f) ;
+    
+    printf("\nlatency from %s, us\n", findEvent(RXLINE) ? findEvent(RXLINE)->name : "RxEnqueue") ;
+    printf("%-20s %8s %10s %10s %10s\n", "event", "count", "min", "mean", "max") ;
+    for (int i = 0 ; i < numEvents ; i++) {
+        EventDesc_t *e = &events[i] ;
+        if (e->count == 0) continue ;
+        printf("%-20s %8u %10.1f %10.1f %10.1f\n", e->name, e->count, e->min / 1e3, 
+               e->total / 1e3 / e->count, e->max / 1e3) ;
+    }
+    return 0 ;
+}
@@ -0,0 +1,110 @@
+/* ======================================================
+    stackfit: stack sizes from repeated stack reports
+
+    Usage: stackfit [--margin PERCENT] [LOG]
+
+    Reads a serial log (default standard input) holding the
+    lines "stack <name> size <bytes> used <bytes>" written by
+    the 'stacks' command or its periodic report, and prints for
+    each thread
+      * the samples, the stack size and the most used
+      * a recommended size: the most used plus the margin
+        (default 25%, at least 32 bytes), rounded up to 8 and
+        no less than the RTX minimum
+      * the bytes that size would save, or add
+
+    A stack whose watermark reached its size may have
+    overflowed: it is flagged and needs a larger size before
+    the recommendation means anything. The watermark only
+    records what has run, so exercise every command (and the
+    error paths) before taking the samples.
+    ========================================================= */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAXTHREADS (16)
+#define MIN_MARGIN (32)
+#define MIN_STACK (96)              // OS_STACK_SIZE lower limit in RTX_Config.h
+#define MIN_IDLE_STACK (72)         // OS_IDLE_THREAD_STACK_SIZE lower limit
+
+typedef struct {
+    char name[32] ;
+    unsigned int samples ;
+    unsigned int size ;             // latest reported
+    unsigned int used ;             // most used
+} Thread_t ;
+
+static Thread_t threads[MAXTHREADS] ;
+static int numThreads ;
+
+static Thread_t *findThread(const char *name) {
+    for (int t = 0 ; t < numThreads ; t++) {
+        if (strcmp(threads[t].name, name) == 0) return &threads[t] ;
+    }
+    if (numThreads == MAXTHREADS) return NULL ;
+    strncpy(threads[numThreads].name, name, sizeof(threads[0].name) - 1) ;
+    return &threads[numThreads++] ;
+}
+
+static unsigned int recommend(const Thread_t *t, unsigned int margin) {
+    unsigned int extra = t->used * margin / 100 ;
+    unsigned int size, min ;
+
+    if (extra < MIN_MARGIN) extra = MIN_MARGIN ;
+    size = (t->used + extra + 7) & ~7u ;
+    min = strstr(t->name, "Idle") ? MIN_IDLE_STACK : MIN_STACK ;
+    return (size < min) ? min : size ;
+}
+
+int main(int argc, char **argv) {
+    FILE *in = stdin ;
+    unsigned int margin = 25 ;
+    char line[256], name[64] ;
+    unsigned int size, used, rec ;
+    long total = 0 ;
+    const char *p ;
+    Thread_t *t ;
+
+    for (int i = 1 ; i < argc ; i++) {
+        if (strcmp(argv[i], "--margin") == 0 && i + 1 < argc) {
+            margin = strtoul(argv[++i], NULL, 10) ;
+        } else if (argv[i][0] != '-' && in == stdin) {
+            in = fopen(argv[i], "r") ;
+            if (in == NULL) {
+                perror(argv[i]) ;
+                return 1 ;
+            }
+        } else {
+            fprintf(stderr, "usage: %s [--margin PERCENT] [LOG]\n", argv[0]) ;
+            return 2 ;
+        }
+    }
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        // the report may follow a prompt on the same line
+        p = strstr(line, "stack ") ;
+        if (p == NULL || sscanf(p, "stack %63s size %u used %u", name, &size, &used) != 3) continue ;
+        t = findThread(name) ;
+        if (t == NULL) continue ;
+        t->samples++ ;
+        t->size = size ;
+        if (used > t->used) t->used = used ;
+    }
+    if (numThreads == 0) {
+        fprintf(stderr, "no stack reports found\n") ;
+        return 1 ;
+    }
+
+    printf("%-20s %7s %5s %5s %11s %6s\n", "thread", "samples", "size", "used", "recommended", "saving") ;
+    for (int i = 0 ; i < numThreads ; i++) {
+        t = &threads[i] ;
+        rec = recommend(t, margin) ;
+        printf("%-20s %7u %5u %5u %11u %6ld%s\n", t->name, t->samples, t->size, t->used,
+               rec, (long)t->size - rec, (t->used >= t->size) ? "  FULL: may have overflowed" : "") ;
+        total += (long)t->size - rec ;
+    }
+    printf("total saving %ld bytes\n", total) ;
+    return 0 ;
+}
@@ -0,0 +1,68 @@
+/* ======================================================
+    clock: clocks for the peripherals in each clock profile
+
+   Interface
+     * initIRClock
+       - Enable MCGIRCLK, kept running in stop modes, for the
+         LPTMR and TPM2: the slow IRC, or in BLPI the fast IRC,
+         which is the core clock and so must stay selected
+
+     * irClock
+       - MCGIRCLK in Hz, measured in core clock terms where the
+         core runs from the IRC: in FEI the core is 640 x the
+         slow IRC, so timing derived from MCGIRCLK agrees with
+         SysTick however far the IRC is from 32768 Hz. In PEE
+         the core runs from the crystal and the nominal IRC
+         frequency is the best estimate
+
+     * uart0Clock
+       - Select the UART0 clock and return its frequency: the FLL
+         or PLL/2 when either drives the core, otherwise (BLPI)
+         OSCERCLK, the 8 MHz crystal, more accurate than the IRC
+
+   Only the FCRDIV reset value (fast IRC / 1) and the FLL
+   default range (640 x) are supported.
+    ========================================================= */
+
+#include <MKL25Z4.h>
+#include "clock.h"
+
+#define FLL_FACTOR (640)        // FEI: FLL output / slow IRC
+
+// MCGOUTCLK source (MCG C1 CLKS)
+#define CLKS_FLL_PLL (0)
+#define CLKS_INTERNAL (1)
+
+static uint32_t clksSelected(void) {
+    return (MCG->C1 & MCG_C1_CLKS_MASK) >> MCG_C1_CLKS_SHIFT ;
+}
+
+// MCGOUTCLK: the core clock before OUTDIV1
+static uint32_t mcgOutClock(void) {
+    return SystemCoreClock * (((SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV1_MASK) >> SIM_CLKDIV1_OUTDIV1_SHIFT) + 1) ;
+}
+
+void initIRClock(void) {
+    if (clksSelected() != CLKS_INTERNAL) MCG->C2 &= ~MCG_C2_IRCS_MASK ;
+    MCG->C1 |= MCG_C1_IRCLKEN_MASK | MCG_C1_IREFSTEN_MASK ;
+}
+
+uint32_t irClock(void) {
+    if (clksSelected() == CLKS_INTERNAL) return mcgOutClock() ;                  // BLPI
+    if (MCG->C1 & MCG_C1_IREFS_MASK) return mcgOutClock() / FLL_FACTOR ;        // FEI
+    return CPU_INT_SLOW_CLK_HZ ;                                                // PEE
+}
+
+uint32_t uart0Clock(void) {
+    uint32_t clock ;
+
+    if (clksSelected() == CLKS_FLL_PLL) {
+        SIM->SOPT2 = (SIM->SOPT2 & ~SIM_SOPT2_UART0SRC_MASK) | SIM_SOPT2_UART0SRC(1) ;
+        clock = mcgOutClock() ;
+        if (SIM->SOPT2 & SIM_SOPT2_PLLFLLSEL_MASK) clock /= 2 ;      // MCGPLLCLK / 2
+    } else {
+        SIM->SOPT2 = (SIM->SOPT2 & ~SIM_SOPT2_UART0SRC_MASK) | SIM_SOPT2_UART0SRC(2) ;
+        clock = CPU_XTAL_CLK_HZ ;
+    }
+    return clock ;
+}
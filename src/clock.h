@@ -0,0 +1,24 @@
+// Header file for the clock profile
+//   Clocks derived from the MCG mode and SystemCoreClock
+//   Function prototypes
+
+#ifndef CLOCK_DEFS_H
+#define CLOCK_DEFS_H
+
+#include <stdint.h>
+
+// Profile set up by SystemInit: CLOCK_SETUP in system_MKL25Z4.h
+//   0 (or undefined) FEI, core 20.97 MHz from the FLL on the slow IRC
+//   1 PEE, core 48 MHz from the PLL on the 8 MHz crystal
+//   2 BLPI, core 4 MHz from the fast IRC, FLL off
+#ifdef CLOCK_SETUP
+#define CLOCK_PROFILE (CLOCK_SETUP)
+#else
+#define CLOCK_PROFILE (0)
+#endif
+
+void initIRClock(void) ;
+uint32_t irClock(void) ;
+uint32_t uart0Clock(void) ;
+
+#endif
@@ -0,0 +1,171 @@
+/* ======================================================
+    command: dispatch of command lines to handlers
+   
+   Interface
+     * initCommands
+       - Register the command table; returns false if not sorted
+       
+     * dispatchCommand
+       - Split a line into name and argument text, in place
+       - Binary search of the table for the name
+       - Parse the argument and call the handler
+       
+     * parseUint
+       - Argument parser for a single unsigned decimal number
+
+     * parseOptionalUint
+       - As parseUint, but the number may be omitted: CMD_NOARG
+
+     * parseUintPair
+       - One or two numbers up to 65535, packed in one value
+
+     * parseTwoUints
+       - As parseUintPair, but both numbers must be given
+
+   The line is parsed where it was read (the readLine buffer): 
+   the name and arguments are not copied. 
+    ========================================================= */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "command.h"
+
+// the registered table
+static const Command_t *commands ;
+static int numCommands ;
+
+/* --------------------------------
+     Register the command table
+
+    The table must be sorted by name so that it can be searched
+    in O(log n) comparisons; false is returned if it is not
+   -------------------------------- */
+bool initCommands(const Command_t *table, int count) {
+    for (int i = 1 ; i < count ; i++) {
+        if (strcmp(table[i-1].name, table[i].name) >= 0) return false ;
+    }
+    commands = table ;
+    numCommands = count ;
+    return true ;
+}
+
+/* --------------------------------
+     Find a command by name 
+    
+    Binary search; NULL if not found
+   -------------------------------- */
+static const Command_t *findCommand(const char *name) {
+    int low = 0 ;
+    int high = numCommands - 1 ;
+    
+    while (low <= high) {
+        int mid = (low + high) / 2 ;
+        int cmp = strcmp(name, commands[mid].name) ;
+        if (cmp == 0) return &commands[mid] ;
+        if (cmp < 0) {
+            high = mid - 1 ;
+        } else {
+            low = mid + 1 ;
+        }
+    }
+    return NULL ;
+}
+
+/* --------------------------------
+     Dispatch a command line
+
+    * Leading spaces are skipped; the name ends at the next space, which 
+      is overwritten by a null. The remaining text is the argument.
+    * Returns CMD_UNKNOWN if the name is not in the table and CMD_BADARG
+      if the argument is rejected; otherwise the handler is called and 
+      CMD_OK returned
+   -------------------------------- */
+int dispatchCommand(char *line) {
+    const Command_t *cmd ;
+    char *args ;
+    uint32_t value = 0 ;
+    
+    while (*line == ' ') line++ ;
+    args = line ;
+    while (*args != 0 && *args != ' ') args++ ;
+    if (*args != 0) *args++ = 0 ;
+    while (*args == ' ') args++ ;
+    
+    cmd = findCommand(line) ;
+    if (cmd == NULL) return CMD_UNKNOWN ;
+    
+    if (cmd->parser == NULL) {
+        if (*args != 0) return CMD_BADARG ;
+    } else if (!cmd->parser(args, &value)) {
+        return CMD_BADARG ;
+    }
+    cmd->handler(value) ;
+    return CMD_OK ;
+}
+
+/* --------------------------------
+     Parse an unsigned decimal number
+
+    Digits only, optionally followed by spaces; at most 9 digits
+   -------------------------------- */
+bool parseUint(char *args, uint32_t *value) {
+    uint32_t v = 0 ;
+    int digits = 0 ;
+    
+    while (*args >= '0' && *args <= '9') {
+        if (++digits > 9) return false ;
+        v = v * 10 + (*args++ - '0') ;
+    }
+    while (*args == ' ') args++ ;
+    if (digits == 0 || *args != 0) return false ;
+    *value = v ;
+    return true ;
+}
+
+/* --------------------------------
+     Parse an optional unsigned decimal number
+
+    No text gives CMD_NOARG; otherwise as parseUint
+   -------------------------------- */
+bool parseOptionalUint(char *args, uint32_t *value) {
+    if (*args == 0) {
+        *value = CMD_NOARG ;
+        return true ;
+    }
+    return parseUint(args, value) ;
+}
+
+/* --------------------------------
+     Parse one or two unsigned decimal numbers
+
+    Each at most 65535, separated by spaces. The value is the first
+    in the upper 16 bits and the second in the lower; if there is
+    only one number it is used for both, unless both are required
+   -------------------------------- */
+static bool parsePair(char *args, uint32_t *value, bool bothRequired) {
+    uint32_t first, second ;
+    char *space = strchr(args, ' ') ;
+    
+    if (space != NULL) {
+        *space++ = 0 ;
+        while (*space == ' ') space++ ;
+    }
+    if (!parseUint(args, &first) || first > 0xFFFF) return false ;
+    if (space == NULL || *space == 0) {
+        if (bothRequired) return false ;
+        second = first ;
+    } else if (!parseUint(space, &second) || second > 0xFFFF) {
+        return false ;
+    }
+    *value = (first << 16) | second ;
+    return true ;
+}
+
+bool parseUintPair(char *args, uint32_t *value) {
+    return parsePair(args, value, false) ;
+}
+
+bool parseTwoUints(char *args, uint32_t *value) {
+    return parsePair(args, value, true) ;
+}
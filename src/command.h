@@ -0,0 +1,41 @@
+// Header file for command dispatch
+//   Command table type
+//   Function prototypes
+
+#ifndef COMMAND_DEFS_H
+#define COMMAND_DEFS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Argument parser: convert the text after the command name
+//   Returns false if the text is not a valid argument
+typedef bool (*cmdParser_t)(char *args, uint32_t *value) ;
+
+// Command handler: called with the parsed argument (0 if none)
+typedef void (*cmdHandler_t)(uint32_t value) ;
+
+// Command table entry
+//   Tables must be sorted by name (strcmp order)
+typedef struct {
+    const char *name ;      // command name
+    cmdHandler_t handler ;  // action
+    cmdParser_t parser ;    // argument parser; NULL if no argument allowed
+} Command_t ;
+
+// values returned by dispatchCommand
+#define CMD_OK (0)
+#define CMD_UNKNOWN (1)
+#define CMD_BADARG (2)
+
+// value passed to the handler when an optional argument is omitted
+#define CMD_NOARG (0xFFFFFFFFu)
+
+bool initCommands(const Command_t *table, int count) ;
+int dispatchCommand(char *line) ;
+bool parseUint(char *args, uint32_t *value) ;
+bool parseOptionalUint(char *args, uint32_t *value) ;
+bool parseUintPair(char *args, uint32_t *value) ;
+bool parseTwoUints(char *args, uint32_t *value) ;
+
+#endif
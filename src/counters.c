@@ -0,0 +1,57 @@
+/* ======================================================
+    counters: runtime event counts
+
+   Interface
+     * countEvent (counters.h)
+       - Add one to a counter; from any thread or handler
+     * formatCounters
+       - All counters on one line: name=value, separated by
+         spaces, in the order of COUNTERS
+     * resetCounters
+       - Set all counters to 0
+
+   Each module counts its events in the one registry, listed in
+   counters.h, so that a monitoring script can read them all
+   with the 'stats' command. A counter is 32 bits and wraps.
+    ========================================================= */
+
+#include <MKL25Z4.h>
+#include <stdio.h>
+#include <string.h>
+#include "counters.h"
+
+volatile uint32_t counters[NUM_COUNTERS] ;
+
+#define COUNTER_NAME(id, name) name,
+static const char * const names[NUM_COUNTERS] = { COUNTERS(COUNTER_NAME) } ;
+
+/* --------------------------------
+     Format the counters
+
+    Returns the length written, as snprintf; the values are
+    copied at once, so they are from the same instant
+   -------------------------------- */
+int formatCounters(char *buf, int size) {
+    uint32_t values[NUM_COUNTERS] ;
+    int n = 0 ;
+
+    int currentMask = __get_PRIMASK() ;
+    __disable_irq() ;
+    for (int i = 0 ; i < NUM_COUNTERS ; i++) {
+        values[i] = counters[i] ;
+    }
+    __set_PRIMASK(currentMask) ;
+
+    buf[0] = '\0' ;
+    for (int i = 0 ; i < NUM_COUNTERS && n < size ; i++) {
+        n += snprintf(buf + n, size - n, (i == 0) ? "%s=%u" : " %s=%u", names[i], values[i]) ;
+    }
+    return n ;
+}
+
+void resetCounters() {
+    int currentMask = __get_PRIMASK() ;
+    __disable_irq() ;
+    memset((void *)counters, 0, sizeof(counters)) ;
+    __set_PRIMASK(currentMask) ;
+}
@@ -0,0 +1,50 @@
+// Header file for runtime counters
+//   The counter registry and the inline increment
+//   Function prototypes
+
+#ifndef COUNTERS_DEFS_H
+#define COUNTERS_DEFS_H
+
+#include <MKL25Z4.h>
+#include <stdint.h>
+
+// Counters: id, name as reported - module, then event
+#define COUNTERS(X) \
+    X(CNT_CMD_LINES,       "cmd.lines")        /* command lines read */ \
+    X(CNT_CMD_UNKNOWN,     "cmd.unknown")      /* not recognised */ \
+    X(CNT_CMD_BADARG,      "cmd.badarg")       /* invalid argument */ \
+    X(CNT_CTRL_BUSY,       "ctrl.busy")        /* control message not sent: controlIQ full */ \
+    X(CNT_UART_OR,         "uart.or")          /* receive overrun */ \
+    X(CNT_UART_NF,         "uart.nf")          /* noise */ \
+    X(CNT_UART_FE,         "uart.fe")          /* framing error */ \
+    X(CNT_UART_PF,         "uart.pf")          /* parity error */ \
+    X(CNT_RX_OVERRUNS,     "rx.overruns")      /* received byte dropped: receive buffer full */ \
+    X(CNT_TX_DROPPED,      "tx.dropped")       /* message not sent: transmit buffer full */ \
+    X(CNT_LED_CHANGES,     "led.changes")      /* LEDs set by the LED thread */ \
+    X(CNT_LED_BLINKS,      "led.blinks")       /* TPM2 started alternating green and red */
+
+#define COUNTER_ID(id, name) id,
+enum { COUNTERS(COUNTER_ID) NUM_COUNTERS } ;
+
+// Longest line formatted, with the null: name, '=', 10 digits and a space each
+#define COUNTERS_LINE (NUM_COUNTERS * 28)
+
+extern volatile uint32_t counters[NUM_COUNTERS] ;
+
+/* --------------------------------
+     Count an event
+
+    A load, add and store with interrupts disabled: safe from
+    threads and handlers alike
+   -------------------------------- */
+static inline void countEvent(int id) {
+    int currentMask = __get_PRIMASK() ;
+    __disable_irq() ;
+    counters[id]++ ;
+    __set_PRIMASK(currentMask) ;
+}
+
+int formatCounters(char *buf, int size) ;
+void resetCounters(void) ;
+
+#endif
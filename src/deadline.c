@@ -0,0 +1,57 @@
+/* ======================================================
+    deadline: signal a thread at an absolute tick
+
+   Interface
+     * initDeadline
+       - Create the one-shot timer; the thread and flag to signal
+       
+     * setDeadline
+       - Schedule the signal for an absolute kernel tick count,
+         replacing any earlier deadline; a deadline already 
+         reached is signalled immediately
+       
+     * deadlinePassed
+       - True once the tick count has reached the deadline; used
+         to discard a flag set for a deadline since replaced
+
+   Successive deadlines are computed from the previous deadline, 
+   not from the time the thread ran, so lateness in waking does
+   not accumulate.
+    ========================================================= */
+
+#include "cmsis_os2.h"
+#include <stdbool.h>
+#include "deadline.h"
+
+// Timer callback: runs in the RTX timer thread
+static void expired(void *arg) {
+    Deadline_t *d = arg ;
+    osThreadFlagsSet(d->thread, d->flag) ;
+}
+
+// The timer control block is part of the Deadline_t
+bool initDeadline(Deadline_t *d, osThreadId_t thread, uint32_t flag) {
+    osTimerAttr_t attr = { .cb_mem = &d->timerCb, .cb_size = sizeof(d->timerCb) } ;
+    
+    d->thread = thread ;
+    d->flag = flag ;
+    d->tick = osKernelGetTickCount() ;
+    d->timer = osTimerNew(expired, osTimerOnce, d, &attr) ;
+    return d->timer != NULL ;
+}
+
+void setDeadline(Deadline_t *d, uint32_t tick) {
+    int32_t ticks = (int32_t)(tick - osKernelGetTickCount()) ;
+    
+    d->tick = tick ;
+    if (ticks <= 0) {
+        osTimerStop(d->timer) ;
+        osThreadFlagsSet(d->thread, d->flag) ;
+    } else {
+        osTimerStart(d->timer, ticks) ;
+    }
+}
+
+bool deadlinePassed(Deadline_t *d) {
+    return (int32_t)(osKernelGetTickCount() - d->tick) >= 0 ;
+}
@@ -0,0 +1,23 @@
+// Header file for deadline timers
+//   One-shot RTX timer that signals a thread at an absolute tick
+//   Function prototypes
+
+#ifndef DEADLINE_DEFS_H
+#define DEADLINE_DEFS_H
+
+#include "rtx_os.h"
+#include <stdbool.h>
+
+typedef struct {
+    osTimerId_t timer ;     // one-shot timer
+    osRtxTimer_t timerCb ;  // its control block
+    osThreadId_t thread ;   // thread signalled
+    uint32_t flag ;         // thread flag set at the deadline
+    uint32_t tick ;         // current deadline: kernel tick count
+} Deadline_t ;
+
+bool initDeadline(Deadline_t *d, osThreadId_t thread, uint32_t flag) ;
+void setDeadline(Deadline_t *d, uint32_t tick) ;
+bool deadlinePassed(Deadline_t *d) ;
+
+#endif
@@ -0,0 +1,45 @@
+// Header file for application events
+//   Event Recorder IDs and recording macros
+//   Events are described for the debugger in lab4.scvd
+//
+//   Recording is enabled when the Compiler:Event Recorder component is
+//   added to the project (RTE_Compiler_EventRecorder); otherwise the 
+//   macros are empty
+
+#ifndef EVENTS_DEFS_H
+#define EVENTS_DEFS_H
+
+// Component numbers - must match lab4.scvd
+#define EVC_LED (0x01)
+#define EVC_QUEUE (0x02)
+#define EVC_COMMAND (0x03)
+#define EVC_SERIAL (0x04)
+
+#ifdef RTE_Compiler_EventRecorder
+
+#include "EventRecorder.h"
+
+// Event IDs                                               val1               val2
+#define EV_LED_STATE    EventID(EventLevelOp, EVC_LED, 0x00)     // LEDs lit (RGB) on-time ms
+#define EV_QUEUE_PUT    EventID(EventLevelOp, EVC_QUEUE, 0x00)   // message         status
+#define EV_QUEUE_GET    EventID(EventLevelOp, EVC_QUEUE, 0x01)   // message         status
+#define EV_CMD_PARSE    EventID(EventLevelOp, EVC_COMMAND, 0x00) // result (CMD_x)  name length
+#define EV_TX_ENQUEUE   EventID(EventLevelDetail, EVC_SERIAL, 0x00) // bytes        bytes held
+#define EV_TX_DEQUEUE   EventID(EventLevelDetail, EVC_SERIAL, 0x01) // total sent   bytes held
+#define EV_RX_ENQUEUE   EventID(EventLevelDetail, EVC_SERIAL, 0x02) // bytes held   overruns
+#define EV_RX_DEQUEUE   EventID(EventLevelDetail, EVC_SERIAL, 0x03) // line length  bytes held
+
+#define EVENT(id, val1, val2) EventRecord2((id), (uint32_t)(val1), (uint32_t)(val2))
+
+#else
+
+#define EVENT(id, val1, val2)
+
+#endif
+
+// LEDs lit, for EV_LED_STATE
+#define EV_RED (0x1)
+#define EV_GREEN (0x2)
+#define EV_BLUE (0x4)
+
+#endif
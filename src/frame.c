@@ -0,0 +1,153 @@
+/* ======================================================
+    frame: binary framed protocol on UART0
+
+   Interface
+     * frameRxByte
+       - Parser state machine, fed one received byte at a time by
+         the UART0 ISR while receive framing is on (setRxFraming)
+       - Valid frames are queued; bad frames are counted and
+         discarded, and the parser resynchronises on FRAME_SYNC
+
+     * getFrame
+       - Next received frame; blocks up to a timeout
+
+     * sendFrame
+       - Queue a frame for transmission; blocks while the
+         transmit buffer is full
+
+   The format and opcodes are in frame.h. The receiver does 
+   not rescan a discarded frame for a sync byte: the sender 
+   is expected to wait for an acknowledgement, or time out, 
+   before resending.
+    ========================================================= */
+
+#include "cmsis_os2.h"
+#include <MKL25Z4.h>
+#include <string.h>
+#include "frame.h"
+#include "ramBudget.h"
+#include "serialPort.h"
+
+// CRC-8 of each 4-bit value: two lookups per byte
+static const uint8_t crcNibble[16] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15, 
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D
+} ;
+
+uint8_t crc8(uint8_t crc, const uint8_t *data, unsigned int length) {
+    while (length--) {
+        crc = (uint8_t)(crc << 4) ^ crcNibble[(crc >> 4) ^ (*data >> 4)] ;
+        crc = (uint8_t)(crc << 4) ^ crcNibble[(crc >> 4) ^ (*data++ & 0x0F)] ;
+    }
+    return crc ;
+}
+
+// ================ Receive ==================
+
+enum { WAIT_SYNC, WAIT_LENGTH, WAIT_OPCODE, WAIT_PAYLOAD, WAIT_CRC } ;
+
+// Parser state - updated by the ISR only
+static struct {
+    int state ;
+    uint8_t crc ;                   // over the bytes so far
+    uint8_t count ;                 // payload bytes received
+    Frame_t frame ;
+} parser ;
+
+static volatile FrameStats_t frameStats ;
+
+osMessageQueueId_t frameQ ;         // received frames
+static osRtxMessageQueue_t frameQCb RTX_SECTION("msgqueue") ;
+static uint32_t frameQMem[osRtxMessageQueueMemSize(FRAMEQ_COUNT, sizeof(Frame_t)) / 4] ;
+static const osMessageQueueAttr_t frameQAttr = {
+    .name = "frameQ", .cb_mem = &frameQCb, .cb_size = sizeof(frameQCb),
+    .mq_mem = frameQMem, .mq_size = sizeof(frameQMem)
+} ;
+
+void initFrames() {
+    resetFrameParser() ;
+    frameQ = osMessageQueueNew(FRAMEQ_COUNT, sizeof(Frame_t), &frameQAttr) ;
+}
+
+void resetFrameParser() {
+    parser.state = WAIT_SYNC ;
+}
+
+/* --------------------------------
+     Receive a byte
+
+    Called from the UART0 ISR, or with that interrupt disabled
+   -------------------------------- */
+void frameRxByte(uint8_t c) {
+    switch (parser.state) {
+    
+    case WAIT_SYNC:
+        if (c == FRAME_SYNC) parser.state = WAIT_LENGTH ;
+        break ;
+    
+    case WAIT_LENGTH:
+        if (c > FRAME_MAX_PAYLOAD) {
+            frameStats.lengthErrors++ ;
+            parser.state = WAIT_SYNC ;
+            break ;
+        }
+        parser.frame.length = c ;
+        parser.crc = crc8(0, &c, 1) ;
+        parser.state = WAIT_OPCODE ;
+        break ;
+    
+    case WAIT_OPCODE:
+        parser.frame.opcode = c ;
+        parser.crc = crc8(parser.crc, &c, 1) ;
+        parser.count = 0 ;
+        parser.state = (parser.frame.length == 0) ? WAIT_CRC : WAIT_PAYLOAD ;
+        break ;
+    
+    case WAIT_PAYLOAD:
+        parser.frame.payload[parser.count++] = c ;
+        parser.crc = crc8(parser.crc, &c, 1) ;
+        if (parser.count == parser.frame.length) parser.state = WAIT_CRC ;
+        break ;
+    
+    case WAIT_CRC:
+        if (c != parser.crc) {
+            frameStats.crcErrors++ ;
+        } else if (osMessageQueuePut(frameQ, &parser.frame, 0, 0) == osOK) {
+            frameStats.frames++ ;
+        } else {
+            frameStats.dropped++ ;
+        }
+        parser.state = WAIT_SYNC ;
+        break ;
+    }
+}
+
+/* --------------------------------
+     Get the next received frame
+
+    False if none arrives within timeout ticks
+   -------------------------------- */
+bool getFrame(Frame_t *frame, uint32_t timeout) {
+    return osMessageQueueGet(frameQ, frame, NULL, timeout) == osOK ;
+}
+
+void getFrameStats(FrameStats_t *stats) {
+    int currentMask = __get_PRIMASK() ; 
+    __disable_irq() ;
+    *stats = frameStats ;
+    __set_PRIMASK(currentMask) ;
+}
+
+// ================ Transmit ==================
+
+bool sendFrame(uint8_t opcode, const uint8_t *payload, uint8_t length) {
+    uint8_t buf[FRAME_MAX_PAYLOAD + FRAME_OVERHEAD] ;
+    
+    if (length > FRAME_MAX_PAYLOAD) return false ;
+    buf[0] = FRAME_SYNC ;
+    buf[1] = length ;
+    buf[2] = opcode ;
+    if (length > 0) memcpy(&buf[3], payload, length) ;
+    buf[3 + length] = crc8(0, &buf[1], length + 2) ;
+    return sendBytes(buf, length + FRAME_OVERHEAD, osWaitForever) ;
+}
@@ -0,0 +1,59 @@
+// Header file for binary framing
+//   Frame format, opcodes and function prototypes
+
+#ifndef FRAME_DEFS_H
+#define FRAME_DEFS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Frame: FRAME_SYNC, length, opcode, payload[length], CRC-8
+//   The CRC (polynomial 0x07, initial 0: CRC-8/SMBUS) covers
+//   the length, opcode and payload bytes
+#define FRAME_SYNC (0xA5)
+#define FRAME_MAX_PAYLOAD (4)
+#define FRAME_OVERHEAD (4)          // sync, length, opcode and CRC
+
+// Opcodes: requests
+#define OP_PING (0x01)              // no action
+#define OP_FASTER (0x02)            // as the faster command
+#define OP_SLOWER (0x03)            // as the slower command
+#define OP_SET (0x04)               // as the set command: payload green, red
+                                    //   on-times ms, 16 bits little-endian; 
+                                    //   red may be omitted
+#define OP_STEP (0x05)              // as the step command: payload colour,
+                                    //   then ms, 16 bits little-endian
+#define OP_PLAY (0x06)              // as the play command
+#define OP_TEXT (0x7F)              // return to the text prompt
+
+// Acknowledgement: opcode of the request | OP_ACK, payload the status
+#define OP_ACK (0x80)
+#define ACK_OK (0)
+#define ACK_UNKNOWN (1)             // opcode not recognised
+#define ACK_BADLEN (2)              // wrong payload length for the opcode
+#define ACK_BUSY (3)                // request could not be queued
+#define ACK_BADARG (4)              // argument out of range
+
+typedef struct {
+    uint8_t opcode ;
+    uint8_t length ;                // payload bytes
+    uint8_t payload[FRAME_MAX_PAYLOAD] ;
+} Frame_t ;
+
+// Receive counts
+typedef struct {
+    uint32_t frames ;               // valid frames received
+    uint32_t crcErrors ;            // frames discarded: CRC mismatch
+    uint32_t lengthErrors ;         // frames discarded: length over FRAME_MAX_PAYLOAD
+    uint32_t dropped ;              // valid frames discarded: queue full
+} FrameStats_t ;
+
+void initFrames(void) ;
+void frameRxByte(uint8_t c) ;
+void resetFrameParser(void) ;
+bool getFrame(Frame_t *frame, uint32_t timeout) ;
+bool sendFrame(uint8_t opcode, const uint8_t *payload, uint8_t length) ;
+uint8_t crc8(uint8_t crc, const uint8_t *data, unsigned int length) ;
+void getFrameStats(FrameStats_t *stats) ;
+
+#endif
@@ -3,11 +3,79 @@
 
     Configuration code for GPIO
     Functions to turn LEDs on and off
+
+    The red and green LEDs are driven either by GPIO or, in 
+    LED_PWM mode, by TPM2 channels 0 and 1. TPM2 counts 
+    MCGIRCLK, which runs in VLPS: the 32768 Hz slow IRC, or the
+    4 MHz fast IRC in BLPI. With ledBlink the LEDs alternate 
+    with no CPU activity:
+      * steady: PWM at 328 Hz (40 kHz in BLPI), 100 counts, lit 
+        for brightness %
+      * blink: one period is the green plus the red on-time; 
+        green is lit until the compare value, then red
+
+    With FAST_GPIO defined the GPIO writes use the IOPORT 
+    aliases (FPTB, FPTD): single-cycle stores from the core 
+    instead of transfers over the peripheral bridge.
  *---------------------------------------------------------------------------*/
  
 #include <MKL25Z4.h>
 #include <stdbool.h>
 #include "gpio.h"
+#include "clock.h"
+#include "isrProfile.h"
+
+#ifdef FAST_GPIO
+#define LEDPORTB FPTB
+#define LEDPORTD FPTD
+#else
+#define LEDPORTB PTB
+#define LEDPORTD PTD
+#endif
+
+#define TEST_PIN_POS (8)    // PTB8, header J9: toggled by gpioToggleCycles
+
+#define PWM_MOD (99)        // steady PWM: 100 counts per period
+#define PWM_MOD_LIMIT (0x10000)   // counts in the longest period
+#define MUX_GPIO (1)
+#define MUX_TPM2 (3)        // PTB18, PTB19 alternative 3
+
+// channel modes: edge-aligned PWM, output low (LED lit) after or before the match
+#define PWM_LIT_AFTER (TPM_CnSC_MSB_MASK | TPM_CnSC_ELSB_MASK)
+#define PWM_LIT_BEFORE (TPM_CnSC_MSB_MASK | TPM_CnSC_ELSA_MASK)
+
+static int ledDriver ;
+static uint32_t tpmClock ;  // MCGIRCLK, Hz
+static unsigned int brightness = LED_FULL ;
+
+/* ----------------------------------------
+   TPM2 helpers
+     Mode changes take effect in the TPM clock domain, which is
+     much slower than the core: each is written and then read back
+     until it has been accepted
+ * ---------------------------------------- */
+static void stopTPM2(void) {
+  TPM2->SC = 0 ;
+  while (TPM2->SC & TPM_SC_CMOD_MASK) ;
+  TPM2->CNT = 0 ;
+}
+
+static void setChannel(int ch, uint32_t mode, uint32_t value) {
+  TPM2->CONTROLS[ch].CnSC = 0 ;
+  while (TPM2->CONTROLS[ch].CnSC != 0) ;
+  TPM2->CONTROLS[ch].CnSC = mode ;
+  while (TPM2->CONTROLS[ch].CnSC != mode) ;
+  TPM2->CONTROLS[ch].CnV = value ;
+}
+
+// Steady PWM with both LEDs off
+static void startSteady(void) {
+  stopTPM2() ;
+  TPM2->MOD = PWM_MOD ;
+  setChannel(RED_TPM_CH, PWM_LIT_BEFORE, 0) ;
+  setChannel(GREEN_TPM_CH, PWM_LIT_BEFORE, 0) ;
+  TPM2->SC = TPM_SC_CMOD(1) | TPM_SC_PS(0) ;
+}
 
 
 /* ----------------------------------------
@@ -16,37 +84,57 @@
      2. Enable GPIO ports
      3. Set GPIO direction to output
      4. Ensure LEDs are off
+     5. For LED_PWM, pass the red and green pins to TPM2
  * ---------------------------------------- */
-void configureGPIOoutput(void) {
+void configureGPIOoutput(int driver) {
 
   // Enable clock to ports B and D
   SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK | SIM_SCGC5_PORTD_MASK;
   
-  // Make 3 pins GPIO
+  // Make 3 pins GPIO, and the test pin
   PORTB->PCR[RED_LED_POS] &= ~PORT_PCR_MUX_MASK;          
   PORTB->PCR[RED_LED_POS] |= PORT_PCR_MUX(1);          
   PORTB->PCR[GREEN_LED_POS] &= ~PORT_PCR_MUX_MASK;          
   PORTB->PCR[GREEN_LED_POS] |= PORT_PCR_MUX(1);          
   PORTD->PCR[BLUE_LED_POS] &= ~PORT_PCR_MUX_MASK;          
   PORTD->PCR[BLUE_LED_POS] |= PORT_PCR_MUX(1);          
+  PORTB->PCR[TEST_PIN_POS] &= ~PORT_PCR_MUX_MASK;
+  PORTB->PCR[TEST_PIN_POS] |= PORT_PCR_MUX(MUX_GPIO);
   
   // Set ports to outputs
-  PTB->PDDR |= MASK(RED_LED_POS) | MASK(GREEN_LED_POS);
-  PTD->PDDR |= MASK(BLUE_LED_POS);
+  LEDPORTB->PDDR |= MASK(RED_LED_POS) | MASK(GREEN_LED_POS) | MASK(TEST_PIN_POS);
+  LEDPORTD->PDDR |= MASK(BLUE_LED_POS);
 
   // Turn off LEDs
-  PTB->PSOR = MASK(RED_LED_POS) | MASK(GREEN_LED_POS);
-  PTD->PSOR = MASK(BLUE_LED_POS);
+  LEDPORTB->PSOR = MASK(RED_LED_POS) | MASK(GREEN_LED_POS);
+  LEDPORTD->PSOR = MASK(BLUE_LED_POS);
+
+  ledDriver = driver;
+  if (driver != LED_PWM) return;
+
+  // TPM2 counts MCGIRCLK, kept running in stop modes
+  SIM->SCGC6 |= SIM_SCGC6_TPM2_MASK;
+  initIRClock();
+  tpmClock = irClock();
+  SIM->SOPT2 = (SIM->SOPT2 & ~SIM_SOPT2_TPMSRC_MASK) | SIM_SOPT2_TPMSRC(3);
+  startSteady();
+
+  PORTB->PCR[RED_LED_POS] &= ~PORT_PCR_MUX_MASK;
+  PORTB->PCR[RED_LED_POS] |= PORT_PCR_MUX(MUX_TPM2);
+  PORTB->PCR[GREEN_LED_POS] &= ~PORT_PCR_MUX_MASK;
+  PORTB->PCR[GREEN_LED_POS] |= PORT_PCR_MUX(MUX_TPM2);
 }
 
 /*----------------------------------------------------------------------------
   Function that turns Red LED on or off
  *----------------------------------------------------------------------------*/
 void redLEDOnOff (int onOff) {
-  if (onOff == LED_ON) {
-    PTB->PCOR = MASK(RED_LED_POS) ;
+  if (ledDriver == LED_PWM) {
+    TPM2->CONTROLS[RED_TPM_CH].CnV = (onOff == LED_ON) ? brightness : 0 ;
+  } else if (onOff == LED_ON) {
+    LEDPORTB->PCOR = MASK(RED_LED_POS) ;
   } else {
-    PTB->PSOR = MASK(RED_LED_POS) ;
+    LEDPORTB->PSOR = MASK(RED_LED_POS) ;
   }
 }
 
@@ -54,10 +142,12 @@ void redLEDOnOff (int onOff) {
   Function that turns Green LED on or off
  *----------------------------------------------------------------------------*/
 void greenLEDOnOff (int onOff) {
-  if (onOff == LED_ON) {
-    PTB->PCOR = MASK(GREEN_LED_POS) ;
+  if (ledDriver == LED_PWM) {
+    TPM2->CONTROLS[GREEN_TPM_CH].CnV = (onOff == LED_ON) ? brightness : 0 ;
+  } else if (onOff == LED_ON) {
+    LEDPORTB->PCOR = MASK(GREEN_LED_POS) ;
   } else {
-    PTB->PSOR = MASK(GREEN_LED_POS) ;
+    LEDPORTB->PSOR = MASK(GREEN_LED_POS) ;
   }
 }
 
@@ -66,9 +156,115 @@ void greenLEDOnOff (int onOff) {
  *----------------------------------------------------------------------------*/
 void blueLEDOnOff (int onOff) {  
   if (onOff == LED_ON) {
-    PTD->PCOR = MASK(BLUE_LED_POS) ;
+    LEDPORTD->PCOR = MASK(BLUE_LED_POS) ;
   } else {
-    PTD->PSOR = MASK(BLUE_LED_POS) ;
+    LEDPORTD->PSOR = MASK(BLUE_LED_POS) ;
   }
 }
 
+/*----------------------------------------------------------------------------
+  Brightness of the red and green LEDs when next turned on, percent
+
+  LED_PWM only; GPIO LEDs are always at full brightness
+ *----------------------------------------------------------------------------*/
+void setLEDBrightness (unsigned int percent) {
+  brightness = (percent > LED_FULL) ? LED_FULL : percent ;
+}
+
+/*----------------------------------------------------------------------------
+  Alternate green and red in hardware, starting with green now
+
+  LED_PWM only: false with GPIO LEDs, which the caller must then
+  time. 0, 0 stops with both LEDs off. Each on-time is rounded to
+  the TPM clock, the slow IRC divided by the smallest prescaler
+  for which the period fits 16 bits: 30.5 us for periods to 2 s,
+  up to 7.8 ms for periods to 256 s. From the fast IRC (BLPI) 
+  periods over 2 s do not fit, and this returns false for them.
+  Blinking is at full brightness.
+ *----------------------------------------------------------------------------*/
+bool ledBlink (uint32_t greenMs, uint32_t redMs) {
+  uint32_t ps, clock ;
+
+  if (ledDriver != LED_PWM) return false ;
+  if (greenMs == 0 && redMs == 0) {
+    startSteady() ;
+    return true ;
+  }
+  for (ps = 0 ; ps <= 7 ; ps++) {
+    if ((uint64_t)(greenMs + redMs) * (tpmClock >> ps) / 1000 <= PWM_MOD_LIMIT) break ;
+  }
+  if (ps > 7) return false ;
+  clock = tpmClock >> ps ;
+
+  stopTPM2() ;
+  TPM2->MOD = (greenMs + redMs) * clock / 1000 - 1 ;
+  setChannel(GREEN_TPM_CH, PWM_LIT_BEFORE, greenMs * clock / 1000) ;
+  setChannel(RED_TPM_CH, PWM_LIT_AFTER, greenMs * clock / 1000) ;
+  TPM2->SC = TPM_SC_CMOD(1) | TPM_SC_PS(ps) ;
+  return true ;
+}
+
+/*----------------------------------------------------------------------------
+  Set all three LEDs: each lit if its bit is in rgb (LED_RED, LED_GREEN,
+  LED_BLUE), the others off
+
+  Red and green change together, with no intermediate state:
+    * GPIO: one store to PTB, the toggle of the bits that differ from
+      the state wanted. Separate PSOR and PCOR stores would leave both
+      LEDs lit, or neither, between them
+    * PWM: both compare values are written in one PWM period, and 
+      TPM2 loads them together at the end of it. The stores are not
+      made in the last count of the period (30 us), so it cannot end
+      between them
+  Blue, on PTD, is a second store. The port is read and written with
+  interrupts disabled, so this may also be called from a handler
+ *----------------------------------------------------------------------------*/
+void setLEDs (unsigned int rgb) {
+  uint32_t litB = ((rgb & LED_RED) ? MASK(RED_LED_POS) : 0) | ((rgb & LED_GREEN) ? MASK(GREEN_LED_POS) : 0) ;
+  uint32_t litD = (rgb & LED_BLUE) ? MASK(BLUE_LED_POS) : 0 ;
+  int currentMask = __get_PRIMASK() ;
+  __disable_irq() ;
+
+  // LEDs are lit by a low output
+  if (ledDriver == LED_PWM) {
+    while (TPM2->CNT == TPM2->MOD) ;
+    TPM2->CONTROLS[RED_TPM_CH].CnV = (rgb & LED_RED) ? brightness : 0 ;
+    TPM2->CONTROLS[GREEN_TPM_CH].CnV = (rgb & LED_GREEN) ? brightness : 0 ;
+  } else {
+    LEDPORTB->PTOR = (LEDPORTB->PDOR ^ ~litB) & (MASK(RED_LED_POS) | MASK(GREEN_LED_POS)) ;
+  }
+  LEDPORTD->PTOR = (LEDPORTD->PDOR ^ ~litD) & MASK(BLUE_LED_POS) ;
+
+  __set_PRIMASK(currentMask) ;
+}
+
+/*----------------------------------------------------------------------------
+  Toggle the test pin GPIO_TOGGLES times with interrupts disabled, through the
+  IOPORT (fast) or the peripheral bridge; returns the core cycles taken
+ *----------------------------------------------------------------------------*/
+#define TOGGLE8(port) \
+  port->PTOR = MASK(TEST_PIN_POS) ; port->PTOR = MASK(TEST_PIN_POS) ; \
+  port->PTOR = MASK(TEST_PIN_POS) ; port->PTOR = MASK(TEST_PIN_POS) ; \
+  port->PTOR = MASK(TEST_PIN_POS) ; port->PTOR = MASK(TEST_PIN_POS) ; \
+  port->PTOR = MASK(TEST_PIN_POS) ; port->PTOR = MASK(TEST_PIN_POS)
+
+uint32_t gpioToggleCycles (bool fast) {
+  uint32_t start, cycles ;
+  int currentMask = __get_PRIMASK() ;
+  __disable_irq() ;
+
+  start = SysTick->VAL ;
+  if (fast) {
+    for (int i = 0 ; i < GPIO_TOGGLES / 8 ; i++) {
+      TOGGLE8(FPTB) ;
+    }
+  } else {
+    for (int i = 0 ; i < GPIO_TOGGLES / 8 ; i++) {
+      TOGGLE8(PTB) ;
+    }
+  }
+  cycles = sysTickElapsed(start) ;
+
+  __set_PRIMASK(currentMask) ;
+  return cycles ;
+}
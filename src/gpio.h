@@ -6,6 +6,7 @@
 #define GPIO_DEFS_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #define MASK(x) (1UL << (x))
 
@@ -14,15 +15,38 @@
 #define GREEN_LED_POS (19)	// on port B
 #define BLUE_LED_POS (1)	// on port D
 
+// TPM2 channels of the red and green LED pins (alternative 3)
+#define RED_TPM_CH (0)
+#define GREEN_TPM_CH (1)
+
+// values used for configureGPIOoutput driver parameter
+#define LED_GPIO (0)    // red and green on / off by GPIO
+#define LED_PWM (1)     // red and green on TPM2: brightness and hardware blink
+
+// LED brightness, percent
+#define LED_FULL (100)
+
+// LEDs for setLEDs
+#define LED_RED (0x1)
+#define LED_GREEN (0x2)
+#define LED_BLUE (0x4)
+
+// Test pin toggles timed by gpioToggleCycles
+#define GPIO_TOGGLES (256)
+
 // LED states
 #define LED_ON  (1)
 #define LED_OFF (0)
 
 // Function prototypes
-void configureGPIOoutput(void) ;
+void configureGPIOoutput(int driver) ;
 void redLEDOnOff (int onOff) ;
 void greenLEDOnOff (int onOff) ;
 void blueLEDOnOff (int onOff) ;
+void setLEDBrightness (unsigned int percent) ;
+bool ledBlink (uint32_t greenMs, uint32_t redMs) ;
+void setLEDs (unsigned int rgb) ;
+uint32_t gpioToggleCycles (bool fast) ;
 
 #endif
 
@@ -0,0 +1,63 @@
+/* ======================================================
+    isrProfile: timing of interrupt handler paths
+
+    Cortex-M0+ has no cycle counter, so SysTick's current value
+    is sampled on entry to the handler and at the end of each 
+    path. Each path accumulates min, max, mean and a histogram 
+    of the elapsed cycles.
+
+    Compiled only when ISR_PROFILE is defined; see isrProfile.h
+    ========================================================= */
+
+#include <MKL25Z4.h>
+#include <stdbool.h>
+#include <string.h>
+#include "isrProfile.h"
+
+#ifdef ISR_PROFILE
+
+static volatile IsrProfile_t profiles[ISR_PATHS] ;
+
+/* --------------------------------
+     Record a sample
+
+    Called from the ISR being profiled
+   -------------------------------- */
+void isrProfileRecord(int path, uint32_t cycles) {
+    volatile IsrProfile_t *p = &profiles[path] ;
+    uint32_t v = cycles >> 4 ;
+    int bucket = 0 ;
+    
+    // bucket is log2(cycles) - 3, clamped
+    while (v != 0 && bucket < ISR_BUCKETS - 1) {
+        v >>= 1 ;
+        bucket++ ;
+    }
+    if (p->count == 0 || cycles < p->min) p->min = cycles ;
+    if (cycles > p->max) p->max = cycles ;
+    p->count++ ;
+    p->total += cycles ;
+    p->hist[bucket]++ ;
+}
+
+/* --------------------------------
+     Copy the profile of a path
+
+    Returns false if the path has no samples
+   -------------------------------- */
+bool getIsrProfile(int path, IsrProfile_t *profile) {
+    int currentMask = __get_PRIMASK() ; 
+    __disable_irq() ;
+    *profile = profiles[path] ;
+    __set_PRIMASK(currentMask) ;
+    return profile->count != 0 ;
+}
+
+void resetIsrProfile() {
+    int currentMask = __get_PRIMASK() ; 
+    __disable_irq() ;
+    memset((void *)profiles, 0, sizeof(profiles)) ;
+    __set_PRIMASK(currentMask) ;
+}
+
+#endif
@@ -0,0 +1,57 @@
+// Header file for ISR profiling
+//   Optional timing of interrupt handler paths using SysTick
+//   Enabled by defining ISR_PROFILE; otherwise the macros are empty
+
+#ifndef ISR_PROFILE_DEFS_H
+#define ISR_PROFILE_DEFS_H
+
+#include <MKL25Z4.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+// Cycles elapsed since start, a value of the down-counting SysTick
+//   Only valid for intervals shorter than one tick
+static inline uint32_t sysTickElapsed(uint32_t start) {
+    uint32_t now = SysTick->VAL ;
+    if (start >= now) return start - now ;
+    return start + SysTick->LOAD + 1 - now ;
+}
+
+// Handler paths profiled
+#define ISR_PATH_ALL (0)      // whole UART0 handler
+#define ISR_PATH_TX (1)       // transmit: entry to end of TDRE handling, or DMA0 handler
+#define ISR_PATH_RX (2)       // receive: entry to end of RDRF handling
+#define ISR_PATH_ERROR (3)    // error: entry to end of error handling
+#define ISR_PATHS (4)
+
+// Histogram bucket n counts durations of 2^(n+3) to 2^(n+4)-1 cycles;
+//   the first and last buckets also hold shorter and longer durations
+#define ISR_BUCKETS (8)
+
+typedef struct {
+    uint32_t count ;                // samples
+    uint32_t min ;                  // cycles
+    uint32_t max ;                  // cycles
+    uint64_t total ;                // cycles, for the mean
+    uint32_t hist[ISR_BUCKETS] ;
+} IsrProfile_t ;
+
+#ifdef ISR_PROFILE
+
+// Place at the start of the handler
+#define ISR_PROFILE_ENTRY() uint32_t isrEntry_ = SysTick->VAL
+// Place at the end of each path, and of the handler for ISR_PATH_ALL
+#define ISR_PROFILE_EXIT(path) isrProfileRecord((path), sysTickElapsed(isrEntry_))
+
+void isrProfileRecord(int path, uint32_t cycles) ;
+bool getIsrProfile(int path, IsrProfile_t *profile) ;
+void resetIsrProfile(void) ;
+
+#else
+
+#define ISR_PROFILE_ENTRY()
+#define ISR_PROFILE_EXIT(path)
+
+#endif
+
+#endif
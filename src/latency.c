@@ -0,0 +1,173 @@
+/* ======================================================
+    latency: command to LED latency and LED jitter
+
+    The UART0 handler stamps each received line end with the
+    RTX system timer, which counts core cycles across ticks,
+    and raises the probe pin. When the LED thread next applies
+    a schedule it takes the time since the stamp, adds it to a
+    histogram and lowers the pin, so the pin's high time on a
+    scope is the same interval. Only the latest line end is
+    timed: a line that sends no message is replaced by the next,
+    and of a burst of commands merged by the LED thread only the
+    last is timed. Lines are stamped in text mode only.
+
+    The jitter of a transition the LED thread times is how late
+    it sets the LEDs after the deadline tick, on the same timer:
+    a tick's count is the tick number times the SysTick period.
+
+    Compiled only when LATENCY_PROBE is defined; see latency.h
+    ========================================================= */
+
+#include "cmsis_os2.h"
+#include <MKL25Z4.h>
+#include <stdbool.h>
+#include <string.h>
+#include "latency.h"
+#include "gpio.h"
+
+#ifdef LATENCY_PROBE
+
+#define MUX_GPIO (1)
+
+static volatile LatencyProfile_t profiles[LATENCY_KINDS] ;
+static volatile uint32_t lineEnd ;      // system timer at the last line end
+static volatile bool pending ;          // a line end not yet followed by a schedule
+
+void initLatencyProbe() {
+    SIM->SCGC5 |= SIM_SCGC5_PORTD_MASK ;
+    PORTD->PCR[LATENCY_PIN_POS] &= ~PORT_PCR_MUX_MASK ;
+    PORTD->PCR[LATENCY_PIN_POS] |= PORT_PCR_MUX(MUX_GPIO) ;
+    PTD->PCOR = MASK(LATENCY_PIN_POS) ;
+    PTD->PDDR |= MASK(LATENCY_PIN_POS) ;
+}
+
+/* --------------------------------
+     Stamp a line end
+
+    Called from the UART0 handler
+   -------------------------------- */
+void latencyLineEnd() {
+    lineEnd = osKernelGetSysTimerCount() ;
+    pending = true ;
+    PTD->PSOR = MASK(LATENCY_PIN_POS) ;
+}
+
+// Histogram bucket of a latency in us
+static int bucket(uint32_t us) {
+    int octave = 0 ;
+
+    if (us < LATENCY_LINEAR) return us ;
+    // us is in [LATENCY_LINEAR << octave, LATENCY_LINEAR << (octave + 1))
+    while (octave < LATENCY_OCTAVES - 1 && (us >> octave) >= 2 * LATENCY_LINEAR) octave++ ;
+    if ((us >> octave) >= 2 * LATENCY_LINEAR) return LATENCY_BUCKETS - 1 ;
+    return LATENCY_LINEAR + octave * LATENCY_SUB +
+           ((us >> octave) - LATENCY_LINEAR) * LATENCY_SUB / LATENCY_LINEAR ;
+}
+
+// The longest latency counted in a bucket, us
+static uint32_t bucketTop(int b) {
+    int octave = (b - LATENCY_LINEAR) / LATENCY_SUB ;
+    int sub = (b - LATENCY_LINEAR) % LATENCY_SUB ;
+
+    if (b < LATENCY_LINEAR) return b ;
+    return ((LATENCY_LINEAR + (sub + 1) * LATENCY_LINEAR / LATENCY_SUB) << octave) - 1 ;
+}
+
+// Add a sample of cycles to a profile
+static void record(int kind, uint32_t cycles) {
+    volatile LatencyProfile_t *p = &profiles[kind] ;
+    uint32_t us = (uint32_t)((uint64_t)cycles * 1000000u / osKernelGetSysTimerFreq()) ;
+
+    int currentMask = __get_PRIMASK() ;
+    __disable_irq() ;
+    p->count++ ;
+    if (us > p->max) p->max = us ;
+    p->hist[bucket(us)]++ ;
+    __set_PRIMASK(currentMask) ;
+}
+
+/* --------------------------------
+     Record the time since the last line end
+
+    Called by the LED thread once it has applied a schedule;
+    nothing is recorded if no line end is pending
+   -------------------------------- */
+void latencyApplied() {
+    uint32_t now = osKernelGetSysTimerCount() ;
+    uint32_t cycles ;
+
+    // start critical region
+    int currentMask = __get_PRIMASK() ;
+    __disable_irq() ;
+    if (!pending) {
+        __set_PRIMASK(currentMask) ;
+        return ;
+    }
+    cycles = now - lineEnd ;
+    pending = false ;
+    PTD->PCOR = MASK(LATENCY_PIN_POS) ;
+    __set_PRIMASK(currentMask) ;
+    // end critical region
+
+    record(LATENCY_COMMAND, cycles) ;
+}
+
+/* --------------------------------
+     Record how late a transition is
+
+    Called by the LED thread once it has set the LEDs for a
+    transition due at a kernel tick
+   -------------------------------- */
+void latencyTransition(uint32_t tick) {
+    uint32_t now = osKernelGetSysTimerCount() ;
+    uint32_t due = tick * (osKernelGetSysTimerFreq() / osKernelGetTickFreq()) ;
+
+    record(LATENCY_JITTER, ((int32_t)(now - due) > 0) ? now - due : 0) ;
+}
+
+/* --------------------------------
+     Copy a profile
+
+    Returns false if there are no samples
+   -------------------------------- */
+bool getLatencyProfile(int kind, LatencyProfile_t *copy) {
+    int currentMask = __get_PRIMASK() ;
+    __disable_irq() ;
+    *copy = profiles[kind] ;
+    __set_PRIMASK(currentMask) ;
+    return copy->count != 0 ;
+}
+
+/* --------------------------------
+     A percentile of a profile, us
+
+    The top of the bucket holding it, or the maximum if less
+   -------------------------------- */
+uint32_t latencyPercentile(const LatencyProfile_t *p, unsigned int percent) {
+    uint32_t rank = (uint32_t)(((uint64_t)p->count * percent + 99) / 100) ;
+    uint32_t seen = 0 ;
+    uint32_t top ;
+
+    if (rank == 0) rank = 1 ;
+    for (int b = 0 ; b < LATENCY_BUCKETS ; b++) {
+        seen += p->hist[b] ;
+        if (seen >= rank) {
+            top = bucketTop(b) ;
+            return (top < p->max) ? top : p->max ;
+        }
+    }
+    return p->max ;
+}
+
+void resetLatencyProfile(int kind) {
+    int currentMask = __get_PRIMASK() ;
+    __disable_irq() ;
+    memset((void *)&profiles[kind], 0, sizeof(profiles[kind])) ;
+    if (kind == LATENCY_COMMAND) {
+        pending = false ;
+        PTD->PCOR = MASK(LATENCY_PIN_POS) ;
+    }
+    __set_PRIMASK(currentMask) ;
+}
+
+#endif
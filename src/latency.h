@@ -0,0 +1,60 @@
+// Header file for command to LED latency and LED jitter measurement
+//   Optional timing from a received line end to the LED thread
+//   applying the schedule it sent, with a probe pin for a scope,
+//   and of each LED transition the thread times after its deadline
+//   Enabled by defining LATENCY_PROBE; otherwise the macros are empty
+
+#ifndef LATENCY_DEFS_H
+#define LATENCY_DEFS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LATENCY_PIN_POS (2)     // PTD2, header J2 pin 8: high from line end to schedule applied
+
+// Intervals profiled
+#define LATENCY_COMMAND (0)     // line end to schedule applied
+#define LATENCY_JITTER (1)      // LED transition deadline to LEDs set
+#define LATENCY_KINDS (2)
+
+// Histogram of latencies in us: 1 us buckets below LATENCY_LINEAR,
+//   then LATENCY_SUB buckets per power of 2, so a percentile is
+//   within 1/LATENCY_SUB of the value; the last bucket also holds
+//   anything longer
+#define LATENCY_LINEAR (8)
+#define LATENCY_SUB (4)
+#define LATENCY_OCTAVES (17)    // 8 us to 1 s
+#define LATENCY_BUCKETS (LATENCY_LINEAR + LATENCY_OCTAVES * LATENCY_SUB)
+
+typedef struct {
+    uint32_t count ;                // samples
+    uint32_t max ;                  // us
+    uint32_t hist[LATENCY_BUCKETS] ;
+} LatencyProfile_t ;
+
+#ifdef LATENCY_PROBE
+
+// Place where the UART0 handler signals a line end
+#define LATENCY_LINE_END() latencyLineEnd()
+// Place where the LED thread has applied a new schedule
+#define LATENCY_APPLIED() latencyApplied()
+// Place where the LED thread has made a transition due at a tick
+#define LATENCY_TRANSITION(tick) latencyTransition(tick)
+
+void initLatencyProbe(void) ;
+void latencyLineEnd(void) ;
+void latencyApplied(void) ;
+void latencyTransition(uint32_t tick) ;
+bool getLatencyProfile(int kind, LatencyProfile_t *profile) ;
+uint32_t latencyPercentile(const LatencyProfile_t *profile, unsigned int percent) ;
+void resetLatencyProfile(int kind) ;
+
+#else
+
+#define LATENCY_LINE_END()
+#define LATENCY_APPLIED()
+#define LATENCY_TRANSITION(tick)
+
+#endif
+
+#endif
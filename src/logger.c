@@ -0,0 +1,135 @@
+/* ======================================================
+    logger: printf-style logging with deferred formatting
+
+   Interface
+     * LOGF (logger.h)
+       - Queue a record of the format and raw arguments; does
+         not block and does not format
+       - Returns false, counting the record dropped, if the
+         buffer is full
+
+     * getLogStats
+       - Records queued and dropped
+
+   A low priority logger thread formats each record with
+   snprintf and sends the line with sendMsgWait, so a caller
+   pays for copying five words rather than for formatting, and
+   may be a handler. Lines appear once higher priority threads
+   are idle, after any output those send meanwhile. Records
+   dropped are reported by the logger when it next runs.
+    ========================================================= */
+
+#include "cmsis_os2.h"
+#include <MKL25Z4.h>
+#include <stdio.h>
+#include "logger.h"
+#include "ramBudget.h"
+#include "serialPort.h"
+
+#define LOGMASK (LOG_RECORDS - 1)       // mask for modulo arithmetic
+
+#if (LOG_RECORDS & LOGMASK) != 0
+#error "LOG_RECORDS must be a power of 2"
+#endif
+
+#define LOG_READY (0x1)                 // thread flag: records queued
+
+// Circular buffer of records: indices run freely, as for the
+//   transmit buffer in serialPort.c
+static struct {
+    LogRecord_t records[LOG_RECORDS] ;
+    unsigned int head ;                 // next record to format - updated by the logger only
+    unsigned int tail ;                 // next free record - updated by LOGF only
+    LogStats_t stats ;
+} volatile logBuf ;
+
+static osThreadId_t t_logger ;
+
+static osRtxThread_t loggerThreadCb RTX_SECTION("thread") ;
+static uint64_t loggerThreadStack[LOGGER_STACK_SIZE / 8] ;
+static const osThreadAttr_t loggerThreadAttr = {
+    .name = "logger",
+    .cb_mem = &loggerThreadCb, .cb_size = sizeof(loggerThreadCb),
+    .stack_mem = loggerThreadStack, .stack_size = sizeof(loggerThreadStack),
+    .priority = osPriorityLow
+} ;
+
+/* --------------------------------
+     Queue a record
+
+    The logger is woken only when the buffer was empty: the
+    rest of a burst costs the copy alone
+   -------------------------------- */
+bool logRecord(const char *format, unsigned int a, unsigned int b, unsigned int c, unsigned int d) {
+    volatile LogRecord_t *r ;
+    unsigned int tail ;
+    bool wake ;
+
+    // start critical region
+    int currentMask = __get_PRIMASK() ;
+    __disable_irq() ;
+    tail = logBuf.tail ;
+    if (tail - logBuf.head == LOG_RECORDS) {
+        logBuf.stats.dropped++ ;
+        __set_PRIMASK(currentMask) ;
+        return false ;
+    }
+    r = &logBuf.records[tail & LOGMASK] ;
+    r->format = format ;
+    r->args[0] = a ;
+    r->args[1] = b ;
+    r->args[2] = c ;
+    r->args[3] = d ;
+    logBuf.tail = tail + 1 ;
+    logBuf.stats.records++ ;
+    wake = (tail == logBuf.head) ;
+    __set_PRIMASK(currentMask) ;
+    // end critical region
+
+    if (wake) osThreadFlagsSet(t_logger, LOG_READY) ;
+    return true ;
+}
+
+// Formats and sends each record; the record is released once copied
+static void loggerThread(void *arg) {
+    volatile LogRecord_t *next ;
+    LogRecord_t r ;
+    char line[LOG_LINE] ;
+    uint32_t dropped, reported = 0 ;
+
+    while (1) {
+        osThreadFlagsWait(LOG_READY, osFlagsWaitAny, osWaitForever) ;
+        while (logBuf.head != logBuf.tail) {
+            next = &logBuf.records[logBuf.head & LOGMASK] ;
+            r.format = next->format ;
+            for (int i = 0 ; i < LOG_ARGS ; i++) {
+                r.args[i] = next->args[i] ;
+            }
+            logBuf.head++ ;
+            snprintf(line, sizeof(line), r.format, r.args[0], r.args[1], r.args[2], r.args[3]) ;
+            sendMsgWait(line, CRLF, osWaitForever) ;
+        }
+        dropped = logBuf.stats.dropped ;
+        if (dropped != reported) {
+            snprintf(line, sizeof(line), "log: %u dropped", dropped - reported) ;
+            sendMsgWait(line, CRLF, osWaitForever) ;
+            reported = dropped ;
+        }
+    }
+}
+
+void initLogger() {
+    logBuf.head = 0 ;
+    logBuf.tail = 0 ;
+    logBuf.stats.records = 0 ;
+    logBuf.stats.dropped = 0 ;
+    t_logger = osThreadNew(loggerThread, NULL, &loggerThreadAttr) ;
+}
+
+void getLogStats(LogStats_t *stats) {
+    int currentMask = __get_PRIMASK() ;
+    __disable_irq() ;
+    stats->records = logBuf.stats.records ;
+    stats->dropped = logBuf.stats.dropped ;
+    __set_PRIMASK(currentMask) ;
+}
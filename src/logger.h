@@ -0,0 +1,50 @@
+// Header file for deferred formatted logging
+//   LOGF macro and function prototypes
+
+#ifndef LOGGER_DEFS_H
+#define LOGGER_DEFS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Records held waiting for the logger thread - power of 2
+#ifndef LOG_RECORDS
+#define LOG_RECORDS (16)
+#endif
+#define LOG_ARGS (4)                // arguments per record, at most
+#define LOG_LINE (96)               // longest line formatted, with the null
+
+// A call: the format and its arguments, not yet formatted
+typedef struct {
+    const char *format ;
+    unsigned int args[LOG_ARGS] ;
+} LogRecord_t ;
+
+// Log counts
+typedef struct {
+    uint32_t records ;              // records queued
+    uint32_t dropped ;              // records discarded: buffer full
+} LogStats_t ;
+
+/* --------------------------------
+     LOGF(format, ...)
+
+    As printf, with up to LOG_ARGS arguments, each an integer
+    of up to 32 bits, converted to unsigned int: use %u, %d,
+    %x or %c, not %s, %p or %lu. The line is formatted later,
+    so the format must not change: use a literal. Calls from
+    threads and handlers may be mixed.
+   -------------------------------- */
+#define LOGF(...) LOG_PICK(__VA_ARGS__, LOG_4, LOG_3, LOG_2, LOG_1, LOG_0, -)(__VA_ARGS__)
+#define LOG_PICK(f, a, b, c, d, n, ...) n
+#define LOG_0(f) logRecord(f, 0, 0, 0, 0)
+#define LOG_1(f, a) logRecord(f, (unsigned int)(a), 0, 0, 0)
+#define LOG_2(f, a, b) logRecord(f, (unsigned int)(a), (unsigned int)(b), 0, 0)
+#define LOG_3(f, a, b, c) logRecord(f, (unsigned int)(a), (unsigned int)(b), (unsigned int)(c), 0)
+#define LOG_4(f, a, b, c, d) logRecord(f, (unsigned int)(a), (unsigned int)(b), (unsigned int)(c), (unsigned int)(d))
+
+void initLogger(void) ;
+bool logRecord(const char *format, unsigned int a, unsigned int b, unsigned int c, unsigned int d) ;
+void getLogStats(LogStats_t *stats) ;
+
+#endif
@@ -0,0 +1,135 @@
+/* ======================================================
+    lowPower: tickless idle on the LPTMR
+
+   Interface
+     * initLowPower
+       - Clock the LPTMR from the internal reference and select
+         the sleep mode: LP_WAIT or LP_VLPS
+
+     * lowPowerSleep
+       - Called by osRtxIdleThread with the kernel suspended and
+         interrupts masked; sleeps until the LPTMR reaches the
+         given number of ticks or another interrupt is pending
+       - Returns the whole ticks slept, for osKernelResume
+
+   The LPTMR counts MCGIRCLK, at irClock() Hz (clock.c): in
+   FEI and BLPI the core runs from the same IRC, a whole number
+   of core cycles per count, so the LPTMR measures time in the
+   same units as SysTick, however far the IRC is from its
+   nominal frequency. In PEE the sleep is timed by the IRC and
+   the ticks by the crystal, so the tick count drifts by the
+   IRC's error while asleep. MCGIRCLK is prescaled, if need be,
+   for LP_MAX_SLEEP to fit the 16-bit counter: to 31250 Hz from
+   the fast IRC. Part ticks are carried to the next sleep.
+
+   In LP_VLPS UART0 is not clocked: the active edge at the start
+   of a received character wakes the core, but that character
+   is lost. VLPS is not entered while transmission is in
+   progress; WAIT is used instead.
+    ========================================================= */
+
+#include <MKL25Z4.h>
+#include <stdbool.h>
+#include "lowPower.h"
+#include "clock.h"
+#include "serialPort.h"
+
+#define LP_TICK_FREQ (1000)     // OS_TICK_FREQ in RTX_Config.h
+#define LPTMR_MAX (0x10000)     // counts in the longest sleep
+#define PRESCALE_MAX (16)       // LPTMR prescaler: 2 to 65536
+#define STOPM_VLPS (2)
+
+static int sleepMode ;
+static uint32_t cyclesPerCount ;    // core cycles per LPTMR count
+static uint32_t residue ;       // core cycles slept not yet returned as ticks
+
+void initLowPower(int mode) {
+    SIM->SCGC5 |= SIM_SCGC5_LPTMR_MASK ;
+
+    // MCGIRCLK, enabled and kept running in stop modes
+    initIRClock() ;
+
+    // LPTMR counts MCGIRCLK, through the smallest prescaler that
+    //   lets LP_MAX_SLEEP fit
+    uint32_t countFreq = irClock() ;
+    int ps = 0 ;
+    while ((uint64_t)LP_MAX_SLEEP * countFreq / LP_TICK_FREQ > LPTMR_MAX && ps < PRESCALE_MAX) {
+        countFreq /= 2 ;
+        ps++ ;
+    }
+    LPTMR0->CSR = 0 ;
+    if (ps == 0) {
+        LPTMR0->PSR = LPTMR_PSR_PCS(0) | LPTMR_PSR_PBYP_MASK ;
+    } else {
+        LPTMR0->PSR = LPTMR_PSR_PCS(0) | LPTMR_PSR_PRESCALE(ps - 1) ;
+    }
+    cyclesPerCount = SystemCoreClock / countFreq ;
+    NVIC_SetPriority(LPTMR0_IRQn, 128) ;
+    NVIC_ClearPendingIRQ(LPTMR0_IRQn) ;
+    NVIC_EnableIRQ(LPTMR0_IRQn) ;
+
+    if (mode == LP_VLPS) {
+        SMC->PMPROT = SMC_PMPROT_AVLP_MASK ;    // write once after reset
+        SMC->PMCTRL = (SMC->PMCTRL & ~SMC_PMCTRL_STOPM_MASK) | SMC_PMCTRL_STOPM(STOPM_VLPS) ;
+    }
+    sleepMode = mode ;
+}
+
+/* --------------------------------
+     Sleep for up to ticks kernel ticks
+
+    osWaitForever and long sleeps are limited to LP_MAX_SLEEP;
+    the idle thread then suspends the kernel again
+   -------------------------------- */
+uint32_t lowPowerSleep(uint32_t ticks) {
+    uint32_t cyclesPerTick = SystemCoreClock / LP_TICK_FREQ ;
+    uint32_t counts, elapsed ;
+    bool deep ;
+
+    if (ticks == 0) return 0 ;
+    if (ticks > LP_MAX_SLEEP) ticks = LP_MAX_SLEEP ;
+    counts = ticks * cyclesPerTick / cyclesPerCount ;
+
+    // start the LPTMR: TCF sets after counts cycles of the IRC
+    LPTMR0->CSR = 0 ;
+    LPTMR0->CMR = LPTMR_CMR_COMPARE(counts - 1) ;
+    LPTMR0->CSR = LPTMR_CSR_TIE_MASK | LPTMR_CSR_TEN_MASK ;
+
+    deep = (sleepMode == LP_VLPS) && txIdle() ;
+    if (deep) {
+        UART0->BDH |= UART0_BDH_RXEDGIE_MASK ;
+        SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk ;
+    } else {
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk ;
+    }
+    __DSB() ;
+    __WFI() ;
+
+    // the counter restarts from 0 on reaching the compare value
+    LPTMR0->CNR = 0 ;           // latches the count for reading
+    elapsed = LPTMR0->CNR & LPTMR_CNR_COUNTER_MASK ;
+    if (LPTMR0->CSR & LPTMR_CSR_TCF_MASK) elapsed += counts ;
+    LPTMR0->CSR = LPTMR_CSR_TCF_MASK ;      // stop and clear the flag
+    NVIC_ClearPendingIRQ(LPTMR0_IRQn) ;
+
+    if (deep) {
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk ;
+        UART0->BDH &= ~UART0_BDH_RXEDGIE_MASK ;
+        UART0->S2 |= UART0_S2_RXEDGIF_MASK ;
+    }
+
+    residue += elapsed * cyclesPerCount ;
+    ticks = residue / cyclesPerTick ;
+    residue -= ticks * cyclesPerTick ;
+    return ticks ;
+}
+
+/* --------------------------------
+     LPTMR0 interrupt
+
+    Not normally taken: lowPowerSleep clears the request before
+    the idle thread unmasks interrupts
+   -------------------------------- */
+void LPTMR0_IRQHandler(void) {
+    LPTMR0->CSR = LPTMR_CSR_TCF_MASK ;
+}
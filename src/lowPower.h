@@ -0,0 +1,20 @@
+// Header file for low-power idle
+//   Tickless sleep on the LPTMR, called from osRtxIdleThread
+//   Function prototypes
+
+#ifndef LOWPOWER_DEFS_H
+#define LOWPOWER_DEFS_H
+
+#include <stdint.h>
+
+// values used for initLowPower mode parameter
+#define LP_WAIT (0)     // core stopped, peripherals clocked: UART0 receives while asleep
+#define LP_VLPS (1)     // very low power stop: an RX edge wakes, but that character is lost
+
+// Longest sleep in kernel ticks: the LPTMR counts 16 bits at about 32 kHz
+#define LP_MAX_SLEEP (1999)
+
+void initLowPower(int mode) ;
+uint32_t lowPowerSleep(uint32_t ticks) ;
+
+#endif
@@ -15,6 +15,7 @@
         -the system is initialised in the GREENON state
         -if the new on-time is yet to be completed when a command is entered the LED will immediately be given the new on-time
         -if the new on-time has already expired when a command is entered the LED that is lit changes immediately
+        -set <ms>, or set <green> <red>, gives the on-times directly
         
     There are three threads
        t_command: waits for input from the terminal; sends message to t_greenLED
@@ -31,8 +32,6 @@
 
 #include "cmsis_os2.h"
 
-#include "string.h"
-
 #include <MKL25Z4.h>
 
 #include <stdbool.h>
@@ -41,8 +40,73 @@
 
 #include "serialPort.h"
 
+#include "command.h"
+
+#include "isrProfile.h"
+
+#include "latency.h"
+
+#include "events.h"
+
+#include "deadline.h"
+
+#include "lowPower.h"
+
+#include "ramBudget.h"
+
+#include "RTX_Config.h"
+
+#include "stacks.h"
+
+#include "frame.h"
+
+#include "logger.h"
+
+#include "sequence.h"
+
+#include "counters.h"
+
+#include "clock.h"
+
+#include <string.h>
+
+#include <stdio.h>
+
 #define RESET_EVT (1)
 
+// UART0 baud rate: divisor and oversampling chosen for the clock profile
+#ifndef UART_BAUD
+#define UART_BAUD (115200)
+#endif
+
+// UART0 transmit mode: TX_INTERRUPT or TX_DMA
+#ifndef UART_TX_MODE
+#define UART_TX_MODE (TX_INTERRUPT)
+#endif
+
+// LED driver: LED_GPIO or LED_PWM (TPM2 brightness and hardware blink)
+//   LED_PWM restarts the blink with green on every new schedule, losing
+//   the phase that the LED thread keeps with LED_GPIO
+#ifndef LED_DRIVER
+#define LED_DRIVER (LED_GPIO)
+#endif
+
+// Idle sleep mode: LP_WAIT or LP_VLPS (loses the first character received)
+#ifndef LOW_POWER_MODE
+#define LOW_POWER_MODE (LP_WAIT)
+#endif
+
+// Scheduling profile: the LED thread pre-empts the command thread, so
+//   that serial input cannot delay a transition, and round-robin is off
+//   (OS_ROBIN_ENABLE in RTX_Config.h); the stack monitor and the logger
+//   run below both. Override to measure another profile
+#ifndef LED_PRIORITY
+#define LED_PRIORITY (osPriorityHigh)
+#endif
+#ifndef COMMAND_PRIORITY
+#define COMMAND_PRIORITY (osPriorityNormal)
+#endif
+
 osMessageQueueId_t controlIQ; // id for the message queue
 osThreadId_t t_greenRedLED; /* id of thread to toggle green led */
 
@@ -50,10 +114,51 @@ osThreadId_t t_greenRedLED; /* id of thread to toggle green led */
 #define GREENON (0)
 #define REDON (1)
 
-enum controlMsg_t {
-  faster,
-  slower
-}; // type for the messages
+// LED schedule: on-time of each colour, ms, and brightness, percent
+typedef struct {
+  uint16_t green;
+  uint16_t red;
+  uint8_t brightness;
+} Schedule_t;
+
+// Control message opcodes: the fields of the schedule a message sets
+#define CTRL_TIMES (0x1)    // green and red
+#define CTRL_BRIGHT (0x2)   // brightness
+#define CTRL_SCHEDULE (CTRL_TIMES | CTRL_BRIGHT)
+#define CTRL_PATTERN (0x4)  // play the pattern committed (sequence.h) instead of green and red
+
+// Control message, sent through controlIQ to the LED thread
+typedef struct {
+  uint8_t opcode;     // CTRL_TIMES, CTRL_BRIGHT or both, or CTRL_PATTERN
+  uint8_t brightness; // percent
+  uint16_t green;     // ms
+  uint16_t red;       // ms
+  uint16_t seq;       // sequence number, from 1
+  uint32_t tick;      // kernel tick when sent
+} ControlMsg_t;
+
+typedef char controlMsgFitsControlIQ[(sizeof(ControlMsg_t) == CONTROLIQ_MSG_SIZE) ? 1 : -1];
+
+// Control message counts
+//   sent and busy are written by the command thread only, the others
+//   by the LED thread only
+typedef struct {
+  uint32_t sent;        // messages queued
+  uint32_t busy;        // not queued: controlIQ full
+  uint32_t received;    // taken from controlIQ by the LED thread
+  uint32_t applied;     // schedule changes made, after coalescing
+  uint32_t maxLatency;  // most ticks from sending to applying
+  uint16_t lastSeq;     // of the last message received
+} ControlStats_t;
+
+volatile ControlStats_t controlStats;
+Schedule_t applied; // the schedule last applied by the LED thread
+unsigned int playing; // steps of the pattern played, 0 if green and red alternate
+
+#define ON_TIME_MIN (10)    // ms
+#define ON_TIME_MAX (60000)
+
+// Preset on-times stepped through by faster and slower
 uint32_t time[] = {
   500,
   1000,
@@ -64,43 +169,154 @@ uint32_t time[] = {
   3500,
   4000
 }; // array of faster slower times
+/*------------------------------------------------------------
+ *  Thread t_greenRedLED
+ *      Alternates the LED colour at the current on-time
+ *
+ *  Transitions are scheduled at absolute tick deadlines by a
+ *  one-shot timer: each deadline is the previous transition
+ *  plus the on-time, so there is no cumulative drift. A new
+ *  on-time is applied from the last transition; if that has
+ *  already passed the colour changes immediately.
+ *
+ *  With the PWM driver at full brightness TPM2 alternates the
+ *  colours instead (ledBlink) and the thread wakes only for a
+ *  new schedule, which restarts the cycle with green.
+ *
+ *  Every message waiting in controlIQ is taken at once and its
+ *  fields merged into the schedule, which is then applied once:
+ *  a burst of commands costs one change, to the latest state.
+ *
+ *  CTRL_PATTERN plays a pattern of steps (sequence.h) instead,
+ *  timed here at any brightness. It starts at once from green
+ *  and red; a pattern replacing another is taken at the end of
+ *  the step lit, so its first step starts exactly on that
+ *  step's deadline. New on-times return to green and red.
+ *------------------------------------------------------------*/
+#define LED_TIMER (0x1) // thread flag: deadline reached
+#define LED_MSG (0x2)   // thread flag: message in controlIQ
+
+Deadline_t ledDeadline;
+
 void greenRedLEDThread(void * arg) {
   int ledState = GREENON; //initial Led colour
-  greenLEDOnOff(LED_OFF); // initialise Led to Off state
-  redLEDOnOff(LED_OFF);
-  uint32_t i = 3; // index of initial switching speed 
+  setLEDs(0); // initialise Led to Off state
+  Schedule_t schedule = { 2000, 2000, LED_FULL }; // replaced by the first message
+  ControlMsg_t msg; // from controlIQ
+  uint32_t onTime = 0; // of the colour lit
+  bool blinking = false; // TPM2 is alternating the colours
   osStatus_t status; // returned by message queue get
-  uint32_t counter, timer;
+  uint32_t flags; // thread flags received
+  uint32_t lastChange; // tick of the last LED transition
+  uint32_t received, latency;
+  bool rescheduled = false; // next transition brought forward by a new schedule, not timed
+  Pattern_t pattern = { NULL, 0 }; // steps played; count 0 for green / red
+  unsigned int step = 0; // next step of the pattern
+  bool takePattern = false; // at the next transition
+  uint8_t changed; // opcodes of the messages merged
+  unsigned int rgb; // LEDs lit by a step
+
+  initDeadline(& ledDeadline, osThreadGetId(), LED_TIMER);
+  lastChange = osKernelGetTickCount();
+  setDeadline(& ledDeadline, lastChange); // first transition now
   while (1) {
-    // wait for message from queue
-    status = osMessageQueueGet(controlIQ, & i, NULL, timer);
-    if (status == osOK) { // message received 
-      counter = osKernelGetTickCount() - counter; // stores time passed in current LED state 
-      if (counter < time[i]) { // determines additional time required
-        timer = time[i] - counter;
-      } else { // immediate LED switch
-        timer = 1;
-      }
-    } else if (status == osErrorTimeout) { // timer finished 
-      timer = time[i]; // new switching speed assigned
-      switch (ledState) {
-
-      case GREENON:
-        counter = osKernelGetTickCount(); // current value of Kernal count 
-        greenLEDOnOff(LED_ON); // set LED colour for current state
-        redLEDOnOff(LED_OFF);
-        ledState = REDON; // next state            
-        break;
+    flags = osThreadFlagsWait(LED_TIMER | LED_MSG, osFlagsWaitAny, osWaitForever);
 
-      case REDON:
-        counter = osKernelGetTickCount(); // current value of Kernal count 
-        redLEDOnOff(LED_ON); // set LED colour for current state
-        greenLEDOnOff(LED_OFF);
-        ledState = GREENON; // next state
-        break;
+    received = 0;
+    changed = 0;
+    if (flags & LED_MSG) { // message(s) received: merged, the latest fields apply
+      while ((status = osMessageQueueGet(controlIQ, & msg, NULL, 0)) == osOK) {
+        EVENT(EV_QUEUE_GET, (msg.green << 16) | msg.red, status);
+        if (msg.opcode & CTRL_TIMES) {
+          schedule.green = msg.green;
+          schedule.red = msg.red;
+          takePattern = false;
+        }
+        if (msg.opcode & CTRL_BRIGHT) schedule.brightness = msg.brightness;
+        if (msg.opcode & CTRL_PATTERN) takePattern = true;
+        changed |= msg.opcode;
+        latency = osKernelGetTickCount() - msg.tick;
+        if (latency > controlStats.maxLatency) controlStats.maxLatency = latency;
+        controlStats.lastSeq = msg.seq;
+        received++;
+      }
+      controlStats.received += received;
+    }
 
+    if (received > 0) { // a flag set after its message was taken finds none
+      controlStats.applied++;
+      applied = schedule;
+      setLEDBrightness(schedule.brightness);
+      if (!takePattern && (changed & CTRL_TIMES)) { // back to green and red
+        seqTake(& pattern); // releasing any pattern committed meanwhile
+        pattern.count = 0;
+      }
+      if (takePattern) { // taken at the end of the step lit
+        if (pattern.count == 0) { // or from green and red, now
+          if (blinking) ledBlink(0, 0);
+          blinking = false;
+          lastChange = osKernelGetTickCount();
+          setDeadline(& ledDeadline, lastChange);
+          rescheduled = true;
+        }
+      } else if (pattern.count > 0) {
+        // brightness only: the pattern plays on
+      } else if (schedule.brightness == LED_FULL && ledBlink(schedule.green, schedule.red)) {
+        blinking = true; // green lit from now
+        countEvent(CNT_LED_BLINKS);
+        EVENT(EV_LED_STATE, EV_GREEN, schedule.green);
+      } else if (blinking) { // back to timing here: next colour now
+        ledBlink(0, 0);
+        blinking = false;
+        lastChange = osKernelGetTickCount();
+        setDeadline(& ledDeadline, lastChange);
+      } else {
+        onTime = (ledState == REDON) ? schedule.green : schedule.red; // REDON next: green lit
+        setDeadline(& ledDeadline, lastChange + onTime); // immediate if already expired
+        rescheduled = (int32_t)(lastChange + onTime - osKernelGetTickCount()) <= 0;
       }
+      LATENCY_APPLIED();
     }
+
+    if ((flags & LED_TIMER) && !blinking && deadlinePassed(& ledDeadline)) { // on-time finished
+      lastChange = ledDeadline.tick;
+      if (takePattern) { // at this step boundary
+        takePattern = false;
+        if (seqTake(& pattern)) step = 0; // otherwise none new: as before
+      }
+      if (pattern.count > 0) {
+        rgb = SEQ_RGB(pattern.steps[step]);
+        onTime = SEQ_MS(pattern.steps[step]);
+        setLEDs(rgb);
+        EVENT(EV_LED_STATE, rgb, onTime); // EV_RED, EV_GREEN, EV_BLUE are the LED_ bits
+        step = (step + 1 < pattern.count) ? step + 1 : 0;
+      } else {
+        switch (ledState) {
+
+        case GREENON:
+          setLEDs(LED_GREEN); // set LED colour for current state
+          onTime = schedule.green;
+          EVENT(EV_LED_STATE, EV_GREEN, onTime);
+          ledState = REDON; // next state            
+          break;
+
+        case REDON:
+          setLEDs(LED_RED); // set LED colour for current state
+          onTime = schedule.red;
+          EVENT(EV_LED_STATE, EV_RED, onTime);
+          ledState = GREENON; // next state
+          break;
+
+        }
+      }
+      countEvent(CNT_LED_CHANGES);
+      if (!rescheduled) {
+        LATENCY_TRANSITION(lastChange);
+      }
+      rescheduled = false;
+      setDeadline(& ledDeadline, lastChange + onTime);
+    }
+    playing = pattern.count;
   }
 }
 
@@ -113,43 +329,658 @@ void greenRedLEDThread(void * arg) {
 osThreadId_t t_command; /* id of thread to receive command */
 
 /* const */
-char prompt[] = "Command: faster / slower>"; // emulator promtpt message
+char prompt[] = "Command (help)>"; // emulator prompt message
 /* const */
 char empty[] = "";
 
+/*------------------------------------------------------------
+ *  Transmit measurement
+ *      Send 1 KB, wait for it to drain and report the
+ *      interrupts taken and CPU load of the transmit path, and
+ *      the longest window with interrupts disabled by a sender
+ *------------------------------------------------------------*/
+#define TXTEST_LINES (16)
+#define TXTEST_LINE "0123456789abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ" // 62 + CRLF = 64 bytes
+
+void txTest(uint32_t value) {
+  TxStats_t stats;
+  char report[100];
+  uint32_t start, elapsed, load;
+
+  osDelay(100); // let the prompt drain
+  resetTxStats();
+  start = osKernelGetTickCount();
+  for (int line = 0; line < TXTEST_LINES; line++) {
+    sendMsgWait(TXTEST_LINE, CRLF, osWaitForever);
+  }
+  do {
+    osDelay(1);
+    getTxStats(& stats);
+  } while (stats.bytes < TXTEST_LINES * 64);
+  elapsed = osKernelGetTickCount() - start;
+
+  // load in 0.1% units: cycles in ISRs / cycles elapsed
+  load = (uint32_t)((uint64_t) stats.cycles * 1000 / ((uint64_t) elapsed * (SystemCoreClock / 1000)));
+  sprintf(report, "%s: %u bytes, %u irqs, %u cycles, %u ms, load %u.%u%%, masked %u cycles",
+    (UART_TX_MODE == TX_DMA) ? "dma" : "irq", stats.bytes, stats.irqs, stats.cycles,
+    elapsed, load / 10, load % 10, stats.maskMax);
+  sendMsg(report, CRLF);
+}
+
+/*------------------------------------------------------------
+ *  Clock report
+ *      The clock profile and the baud rate achieved: the UART0
+ *      clock, divisor and oversampling ratio, and the error
+ *------------------------------------------------------------*/
+// Write a baud error as a signed percentage, to 0.01%
+int sprintBaudError(char * s, int32_t errorPpm) {
+  uint32_t error = (errorPpm < 0) ? -errorPpm : errorPpm;
+  error = (error + 50) / 100; // 0.01% units
+  return sprintf(s, "%c%u.%02u%%", (errorPpm < 0) ? '-' : '+', error / 100, error % 100);
+}
+
+void clockReport(void) {
+  BaudInfo_t baud;
+  char report[100];
+  int n;
+
+  getBaudInfo(& baud);
+  n = sprintf(report, "clock profile %u: core %u Hz; uart0 %u baud, clock %u Hz, sbr %u, osr %u, error ",
+    CLOCK_PROFILE, SystemCoreClock, baud.requested, baud.clock, baud.sbr, baud.osr);
+  sprintBaudError(report + n, baud.errorPpm);
+  sendMsgWait(report, CRLF, osWaitForever);
+  if (baud.errorPpm > BAUD_ERROR_MAX || baud.errorPpm < -BAUD_ERROR_MAX) {
+    sendMsgWait("baud error too large: reception unreliable", CRLF, osWaitForever);
+  }
+}
+
+/*------------------------------------------------------------
+ *  GPIO toggle measurement
+ *      Toggle rate of a pin through the peripheral bridge (PTB)
+ *      and through the IOPORT (FPTB), and the path the LED
+ *      functions use
+ *------------------------------------------------------------*/
+void gpioTest(uint32_t value) {
+  static const char * const pathNames[2] = { "gpio", "fgpio" };
+  char report[80];
+  uint32_t cycles;
+
+  for (int fast = 0; fast < 2; fast++) {
+    cycles = gpioToggleCycles(fast);
+    if (cycles == 0) cycles = 1;
+    sprintf(report, "%-5s: %u toggles, %u cycles, %u.%02u cycles each, %u toggles/s",
+      pathNames[fast], GPIO_TOGGLES, cycles, cycles / GPIO_TOGGLES, (cycles % GPIO_TOGGLES) * 100 / GPIO_TOGGLES,
+      (uint32_t)((uint64_t) SystemCoreClock * GPIO_TOGGLES / cycles));
+    sendMsgWait(report, CRLF, osWaitForever);
+  }
+#ifdef FAST_GPIO
+  sendMsg("LED path: fgpio", CRLF);
+#else
+  sendMsg("LED path: gpio", CRLF);
+#endif
+}
+
+/*------------------------------------------------------------
+ *  Command handlers
+ *      The table is searched by dispatchCommand and must be
+ *      kept sorted by name
+ *------------------------------------------------------------*/
+#define LINE_SIZE (40) // maximum command line length
+#define NUM_TIMES (8)  // entries in time[]
+
+int speed = 3; // index in time[] of the last preset sent
+Schedule_t current = { 2000, 2000, LED_FULL }; // schedule as last sent
+uint16_t controlSeq; // of the last control message sent
+
+// Validate the fields of the schedule given by opcode and send them
+//   to the LED thread. Does not block: osErrorResource if controlIQ
+//   is full, osErrorParameter if any value is out of range
+osStatus_t sendControl(uint8_t opcode, uint32_t green, uint32_t red, uint32_t brightness) {
+  ControlMsg_t msg;
+  osStatus_t status;
+  if (((opcode & CTRL_TIMES) &&
+       (green < ON_TIME_MIN || green > ON_TIME_MAX || red < ON_TIME_MIN || red > ON_TIME_MAX)) ||
+      ((opcode & CTRL_BRIGHT) && brightness > LED_FULL)) {
+    return osErrorParameter;
+  }
+  msg.opcode = opcode;
+  msg.green = green;
+  msg.red = red;
+  msg.brightness = brightness;
+  msg.seq = controlSeq + 1;
+  msg.tick = osKernelGetTickCount();
+  status = osMessageQueuePut(controlIQ, & msg, 0, 0); // Send Message
+  EVENT(EV_QUEUE_PUT, (green << 16) | red, status);
+  if (status != osOK) {
+    controlStats.busy++;
+    countEvent(CNT_CTRL_BUSY);
+    return status;
+  }
+  controlSeq = msg.seq;
+  controlStats.sent++;
+  osThreadFlagsSet(t_greenRedLED, LED_MSG);
+  if (opcode & CTRL_TIMES) {
+    current.green = green;
+    current.red = red;
+  }
+  if (opcode & CTRL_BRIGHT) current.brightness = brightness;
+  return status;
+}
+
+// Step to the next preset, -1 (faster) or +1 (slower), wrapping round;
+// the index is kept if the message cannot be queued
+osStatus_t stepSpeed(int step) {
+  int next = (speed + step + NUM_TIMES) % NUM_TIMES;
+  osStatus_t status = sendControl(CTRL_TIMES, time[next], time[next], 0);
+  if (status == osOK) {
+    speed = next;
+  }
+  return status;
+}
+
+void fasterCmd(uint32_t value) {
+  if (stepSpeed(-1) != osOK) sendMsg("busy", CRLF);
+}
+
+void slowerCmd(uint32_t value) {
+  if (stepSpeed(1) != osOK) sendMsg("busy", CRLF);
+}
+
+// 'set <ms>' for equal on-times, 'set <green> <red>' for each colour
+void setCmd(uint32_t value) {
+  switch (sendControl(CTRL_TIMES, value >> 16, value & 0xFFFF, 0)) {
+
+  case osOK:
+    break;
+
+  case osErrorParameter:
+    sendMsg("on-times are 10 to 60000 ms", CRLF);
+    break;
+
+  default:
+    sendMsg("busy", CRLF);
+    break;
+  }
+}
+
+// 'bright <percent>': LED brightness with the PWM driver; below 100
+// the LED thread times the transitions
+void brightCmd(uint32_t value) {
+  switch (sendControl(CTRL_BRIGHT, 0, 0, value)) {
+
+  case osOK:
+    break;
+
+  case osErrorParameter:
+    sendMsg("brightness is 0 to 100 %", CRLF);
+    break;
+
+  default:
+    sendMsg("busy", CRLF);
+    break;
+  }
+}
+
+// 'step <colour> <ms>': add a step to the pattern being loaded, lighting
+// red (1), green (2) and blue (4) for 1 to 8191 ms
+void stepCmd(uint32_t value) {
+  switch (seqAppend(value >> 16, value & 0xFFFF)) {
+
+  case SEQ_OK:
+    break;
+
+  case SEQ_BADARG:
+    sendMsg("colour is 0 to 7, time 1 to 8191 ms", CRLF);
+    break;
+
+  case SEQ_FULL:
+    sendMsg("pattern full", CRLF);
+    break;
+
+  default:
+    sendMsg("busy", CRLF);
+    break;
+  }
+}
+
+// Commit the pattern loaded and signal the LED thread: SEQ_OK, SEQ_BADARG
+// if no steps are loaded or SEQ_BUSY if controlIQ is full; may be repeated
+int playPattern(void) {
+  int status = seqCommit();
+  if (status == SEQ_OK && sendControl(CTRL_PATTERN, 0, 0, 0) != osOK) {
+    status = SEQ_BUSY;
+  }
+  return status;
+}
+
+// 'play': the pattern loaded replaces the one playing, or green and red,
+// when the current step or on-time ends; faster, slower and set return to
+// green and red
+void playCmd(uint32_t value) {
+  switch (playPattern()) {
+
+  case SEQ_OK:
+    break;
+
+  case SEQ_BADARG:
+    sendMsg("no steps loaded", CRLF);
+    break;
+
+  default:
+    sendMsg("busy", CRLF);
+    break;
+  }
+}
+
+/*------------------------------------------------------------
+ *  Control message report
+ *      Messages sent, refused and received, the schedule changes
+ *      the LED thread made from them and the schedule it applied,
+ *      and the steps of the pattern loaded and of the one played
+ *------------------------------------------------------------*/
+void controlCmd(uint32_t value) {
+  char report[100];
+
+  sprintf(report, "control sent %u busy %u received %u applied %u seq %u latency %u ms",
+    controlStats.sent, controlStats.busy, controlStats.received, controlStats.applied,
+    controlStats.lastSeq, controlStats.maxLatency);
+  sendMsgWait(report, CRLF, osWaitForever);
+  sprintf(report, "applied green %u red %u bright %u", applied.green, applied.red, applied.brightness);
+  sendMsgWait(report, CRLF, osWaitForever);
+  sprintf(report, "pattern loaded %u playing %u steps", seqLoaded(), playing);
+  sendMsgWait(report, CRLF, osWaitForever);
+}
+
+/*------------------------------------------------------------
+ *  Binary framed protocol (see frame.h)
+ *      Every frame received is acknowledged; OP_TEXT returns to
+ *      the text prompt and the receive counts are reported. So
+ *      that a rig lost or a corrupted stream cannot hold the
+ *      console, it also returns after BINARY_IDLE_MS without a
+ *      valid frame, or after BINARY_CRC_RUN CRC errors in a row
+ *------------------------------------------------------------*/
+#define BINARY_POLL_MS (100)    // ticks: OS_TICK_FREQ is 1000
+#define BINARY_IDLE_MS (10000)
+#define BINARY_CRC_RUN (8)
+
+void binaryCmd(uint32_t value) {
+  Frame_t frame;
+  FrameStats_t stats;
+  char report[80];
+  uint8_t status;
+  uint32_t green, red;
+  uint32_t lastFrame, crcErrors;
+
+  setRxFraming(true);
+  lastFrame = osKernelGetTickCount();
+  getFrameStats(& stats);
+  crcErrors = stats.crcErrors;
+  while (1) {
+    if (!getFrame(& frame, BINARY_POLL_MS)) {
+      getFrameStats(& stats);
+      if (stats.crcErrors - crcErrors >= BINARY_CRC_RUN) {
+        sendMsgWait("binary: crc errors, text resumed", CRLF, osWaitForever);
+        break;
+      }
+      if (osKernelGetTickCount() - lastFrame >= BINARY_IDLE_MS) {
+        sendMsgWait("binary: no frames, text resumed", CRLF, osWaitForever);
+        break;
+      }
+      continue;
+    }
+    lastFrame = osKernelGetTickCount();
+    getFrameStats(& stats);
+    crcErrors = stats.crcErrors;
+    switch (frame.opcode) {
+
+    case OP_PING:
+    case OP_TEXT:
+      status = (frame.length == 0) ? ACK_OK : ACK_BADLEN;
+      break;
+
+    case OP_FASTER:
+    case OP_SLOWER:
+      if (frame.length != 0) {
+        status = ACK_BADLEN;
+      } else {
+        status = (stepSpeed((frame.opcode == OP_FASTER) ? -1 : 1) == osOK) ? ACK_OK : ACK_BUSY;
+      }
+      break;
+
+    case OP_SET:
+      if (frame.length != 2 && frame.length != 4) {
+        status = ACK_BADLEN;
+        break;
+      }
+      green = frame.payload[0] | (frame.payload[1] << 8);
+      red = (frame.length == 4) ? (uint32_t) (frame.payload[2] | (frame.payload[3] << 8)) : green;
+      switch (sendControl(CTRL_TIMES, green, red, 0)) {
+      case osOK:             status = ACK_OK;     break;
+      case osErrorParameter: status = ACK_BADARG; break;
+      default:               status = ACK_BUSY;   break;
+      }
+      break;
+
+    case OP_STEP:
+      if (frame.length != 3) {
+        status = ACK_BADLEN;
+        break;
+      }
+      switch (seqAppend(frame.payload[0], frame.payload[1] | (frame.payload[2] << 8))) {
+      case SEQ_OK:           status = ACK_OK;     break;
+      case SEQ_BUSY:         status = ACK_BUSY;   break;
+      default:               status = ACK_BADARG; break;
+      }
+      break;
+
+    case OP_PLAY:
+      if (frame.length != 0) {
+        status = ACK_BADLEN;
+        break;
+      }
+      switch (playPattern()) {
+      case SEQ_OK:           status = ACK_OK;     break;
+      case SEQ_BUSY:         status = ACK_BUSY;   break;
+      default:               status = ACK_BADARG; break;
+      }
+      break;
+
+    default:
+      status = ACK_UNKNOWN;
+      break;
+    }
+    sendFrame(frame.opcode | OP_ACK, & status, 1);
+    if (frame.opcode == OP_TEXT && status == ACK_OK) break;
+  }
+  setRxFraming(false);
+
+  // frames sent after OP_TEXT are discarded
+  while (getFrame(& frame, 0)) {}
+  getFrameStats(& stats);
+  sprintf(report, "frames %u crc errors %u length errors %u dropped %u",
+    stats.frames, stats.crcErrors, stats.lengthErrors, stats.dropped);
+  sendMsgWait(report, CRLF, osWaitForever);
+}
+
+/*------------------------------------------------------------
+ *  Statistics report
+ *      The counters (see counters.h) on one line, then with
+ *      ISR_PROFILE one line per UART0 handler path: samples,
+ *      min / mean / max cycles and the histogram (see
+ *      isrProfile.h). 'stats reset' reports and then clears them
+ *------------------------------------------------------------*/
+#define STATS_RESET (1)
+
+// 'stats' or 'stats reset'
+bool parseStatsArg(char * args, uint32_t * value) {
+  if (*args == 0) {
+    *value = CMD_NOARG;
+    return true;
+  }
+  if (strcmp(args, "reset") == 0) {
+    *value = STATS_RESET;
+    return true;
+  }
+  return false;
+}
+
+void statsCmd(uint32_t value) {
+  static char line[COUNTERS_LINE + 8]; // too long for the stack
+#ifdef ISR_PROFILE
+  static const char * const pathNames[ISR_PATHS] = { "all", "tx", "rx", "error" };
+  IsrProfile_t profile;
+  char report[120];
+  int n;
+#endif
+
+  strcpy(line, "stats ");
+  formatCounters(line + 6, sizeof(line) - 6);
+  sendMsgWait(line, CRLF, osWaitForever);
+#ifdef ISR_PROFILE
+
+  for (int path = 0; path < ISR_PATHS; path++) {
+    if (!getIsrProfile(path, & profile)) continue;
+    n = sprintf(report, "isr %s n=%u min=%u mean=%u max=%u hist=", pathNames[path],
+      profile.count, profile.min, (uint32_t)(profile.total / profile.count), profile.max);
+    for (int b = 0; b < ISR_BUCKETS; b++) {
+      n += sprintf(report + n, (b == 0) ? "%u" : ",%u", profile.hist[b]);
+    }
+    sendMsgWait(report, CRLF, osWaitForever);
+  }
+#endif
+  if (value == STATS_RESET) {
+    resetCounters();
+#ifdef ISR_PROFILE
+    resetIsrProfile();
+#endif
+  }
+}
+
+/*------------------------------------------------------------
+ *  Latency and jitter reports
+ *      Samples and the 50th and 99th percentile and longest
+ *      time, in us (see latency.h), with the scheduling profile
+ *      measured; then each starts again
+ *
+ *  latency: from a line end to the LED thread applying the
+ *      schedule it sent
+ *  jitter: from the deadline of an LED transition timed by
+ *      the LED thread to the LEDs being set; transitions made
+ *      at once by a new schedule are not counted
+ *------------------------------------------------------------*/
+#ifdef LATENCY_PROBE
+void latencyReport(const char * name, int kind) {
+  LatencyProfile_t profile;
+  char report[100];
+
+  getLatencyProfile(kind, & profile);
+  resetLatencyProfile(kind);
+  sprintf(report, "%s n=%u p50=%u p99=%u max=%u us", name, profile.count,
+    latencyPercentile(& profile, 50), latencyPercentile(& profile, 99), profile.max);
+  sendMsgWait(report, CRLF, osWaitForever);
+  sprintf(report, "led priority %d command priority %d round-robin %d controlIQ %d",
+    LED_PRIORITY, COMMAND_PRIORITY, OS_ROBIN_ENABLE, CONTROLIQ_COUNT);
+  sendMsgWait(report, CRLF, osWaitForever);
+}
+#endif
+
+void latencyCmd(uint32_t value) {
+#ifdef LATENCY_PROBE
+  latencyReport("latency", LATENCY_COMMAND);
+#else
+  sendMsg("latency probe not enabled (LATENCY_PROBE)", CRLF);
+#endif
+}
+
+void jitterCmd(uint32_t value) {
+#ifdef LATENCY_PROBE
+  latencyReport("jitter", LATENCY_JITTER);
+#else
+  sendMsg("latency probe not enabled (LATENCY_PROBE)", CRLF);
+#endif
+}
+
+/*------------------------------------------------------------
+ *  Logging measurement
+ *      Cycles per call of LOGF, which queues a record for the
+ *      logger thread, and of formatting in place with sprintf
+ *      and sendMsg, for the same line; mean and longest
+ *------------------------------------------------------------*/
+#define LOGTEST_CALLS (8) // no more than LOG_RECORDS
+
+void logTest(uint32_t value) {
+  static const char * const pathNames[2] = { "logf", "in place" };
+  uint32_t total[2] = { 0, 0 }, longest[2] = { 0, 0 };
+  uint32_t start, cycles;
+  char line[48];
+
+  osDelay(100); // let the prompt drain
+  for (int path = 0; path < 2; path++) {
+    for (uint32_t i = 0; i < LOGTEST_CALLS; i++) {
+      start = SysTick->VAL;
+      if (path == 0) {
+        LOGF("logtest %u green %u ms red %u ms", i, current.green, current.red);
+      } else {
+        sprintf(line, "logtest %u green %u ms red %u ms", i, current.green, current.red);
+        sendMsg(line, CRLF);
+      }
+      cycles = sysTickElapsed(start);
+      total[path] += cycles;
+      if (cycles > longest[path]) longest[path] = cycles;
+    }
+  }
+  osDelay(100); // let the logger send its lines first
+  for (int path = 0; path < 2; path++) {
+    sprintf(line, "%-8s: mean %u max %u cycles", pathNames[path], total[path] / LOGTEST_CALLS, longest[path]);
+    sendMsgWait(line, CRLF, osWaitForever);
+  }
+}
+
+/*------------------------------------------------------------
+ *  Baud rate negotiation
+ *      'baud <rate>' is acknowledged at the old rate with
+ *      'baud <rate> switching'. Once that has been sent the rate
+ *      changes, and the host must send the line 'baud' at the
+ *      new rate within BAUD_CONFIRM_MS; 'baud <rate> ok' then
+ *      confirms it. Otherwise the old rate is restored and
+ *      'baud <old rate> reverted' sent at it. Rates whose error
+ *      would exceed BAUD_ERROR_MAX are refused.
+ *------------------------------------------------------------*/
+#define BAUD_MIN (1200)
+#define BAUD_MAX (921600)
+#define BAUD_CONFIRM_MS (2000) // ticks: OS_TICK_FREQ is 1000
+
+void baudCmd(uint32_t value) {
+  BaudInfo_t old, next;
+  char line[LINE_SIZE + 1];
+  char report[60];
+  uint32_t start, waited;
+
+  if (value < BAUD_MIN || value > BAUD_MAX) {
+    sendMsg("baud rates are 1200 to 921600", CRLF);
+    return;
+  }
+  getBaudInfo(& old);
+  findBaud(value, & next);
+  if (next.errorPpm > BAUD_ERROR_MAX || next.errorPpm < -BAUD_ERROR_MAX) {
+    sprintBaudError(report + sprintf(report, "baud %u not supported: error ", value), next.errorPpm);
+    sendMsg(report, CRLF);
+    return;
+  }
+  sprintf(report, "baud %u switching", value);
+  sendMsgWait(report, CRLF, osWaitForever);
+  setBaudRate(value);
+
+  start = osKernelGetTickCount();
+  // a line cut short also returns false: only the time running out reverts
+  while ((waited = osKernelGetTickCount() - start) < BAUD_CONFIRM_MS) {
+    if (readLineWait(line, LINE_SIZE, BAUD_CONFIRM_MS - waited) && strcmp(line, "baud") == 0) {
+      sprintf(report, "baud %u ok", value);
+      sendMsg(report, CRLF);
+      return;
+    }
+  }
+  setBaudRate(old.requested);
+  sprintf(report, "baud %u reverted", old.requested);
+  sendMsg(report, CRLF);
+}
+
+/*------------------------------------------------------------
+ *  RAM budget report
+ *      One line per statically allocated object, then the total
+ *------------------------------------------------------------*/
+void memCmd(uint32_t value) {
+  char report[LINE_SIZE + 1];
+
+  for (int r = 0; r < ramBudgetCount; r++) {
+    sprintf(report, "%-20s %5u", ramBudget[r].name, ramBudget[r].bytes);
+    sendMsgWait(report, CRLF, osWaitForever);
+  }
+  sprintf(report, "%-20s %5u of %u", "total", ramBudgetTotal(), IRAM_SIZE);
+  sendMsgWait(report, CRLF, osWaitForever);
+}
+
+/*------------------------------------------------------------
+ *  Stack report
+ *      'stacks' reports now; 'stacks <s>' every s seconds, 0 to stop
+ *------------------------------------------------------------*/
+bool parseStacksArg(char * args, uint32_t * value) {
+  if (!parseOptionalUint(args, value)) return false;
+  return (*value == CMD_NOARG) || (*value <= STACK_REPORT_MAX);
+}
+
+void stacksCmd(uint32_t value) {
+  if (value == CMD_NOARG) {
+    reportStacks();
+  } else {
+    setStackReport(value);
+  }
+}
+
+void helpCmd(uint32_t value);
+
+const Command_t commandTable[] = {
+  { "baud",   baudCmd,   parseUint },
+  { "binary", binaryCmd, NULL },
+  { "bright", brightCmd, parseUint },
+  { "control", controlCmd, NULL },
+  { "faster", fasterCmd, NULL },
+  { "gpiotest", gpioTest, NULL },
+  { "help",   helpCmd,   NULL },
+  { "jitter", jitterCmd, NULL },
+  { "latency", latencyCmd, NULL },
+  { "logtest", logTest,  NULL },
+  { "mem",    memCmd,    NULL },
+  { "play",   playCmd,   NULL },
+  { "set",    setCmd,    parseUintPair },
+  { "slower", slowerCmd, NULL },
+  { "stacks", stacksCmd, parseStacksArg },
+  { "stats",  statsCmd,  parseStatsArg },
+  { "step",   stepCmd,   parseTwoUints },
+  { "txtest", txTest,    NULL },
+};
+#define NUM_COMMANDS (sizeof(commandTable) / sizeof(commandTable[0]))
+
+void helpCmd(uint32_t value) {
+  for (unsigned int c = 0; c < NUM_COMMANDS; c++) {
+    sendMsgWait((char *) commandTable[c].name, CRLF, osWaitForever);
+  }
+}
+
 void commandThread(void * arg) {
-  int i = 3; // index of initial switching speed
-  char response[6]; // buffer for response string
-  enum controlMsg_t msg;
-  osMessageQueuePut(controlIQ, & i, 0, NULL);
-  bool valid;
+  char response[LINE_SIZE + 1]; // buffer for response string
+  static char echo[LINE_SIZE + 1]; // the line as typed; dispatch splits response
+  int result; // of command dispatch
+  sendControl(CTRL_SCHEDULE, time[speed], time[speed], current.brightness);
+  clockReport();
+  if (!initCommands(commandTable, NUM_COMMANDS)) {
+    sendMsg("command table not sorted", CRLF);
+  }
   while (1) {
     sendMsg(empty, CRLF);
     sendMsg(prompt, NOLINE);
-    readLine(response, 6); // 
-    valid = true;
-    if (strcmp(response, "faster") == 0) {
-      msg = faster;
-    } else if (strcmp(response, "slower") == 0) {
-      msg = slower;
-    } else valid = false;
-
-    if (valid) {
-      if (msg == slower) {
-        i = i + 1;
-        if (i > 7) {
-          i = 0;
-        }
-      } else if (msg == faster) {
-        i = i - 1;
-        if (i < 0) {
-          i = 7;
-        }
-      }
-      osMessageQueuePut(controlIQ, & i, 0, NULL); // Send Message     
-    } else {
-      sendMsg(response, NOLINE);
+    if (!readLine(response, LINE_SIZE)) {
+      sendMsg("line too long", CRLF);
+      continue;
+    }
+    countEvent(CNT_CMD_LINES);
+    strcpy(echo, response);
+    result = dispatchCommand(response);
+    EVENT(EV_CMD_PARSE, result, strlen(response));
+    switch (result) {
+
+    case CMD_UNKNOWN:
+      countEvent(CNT_CMD_UNKNOWN);
+      sendMsg(echo, NOLINE);
       sendMsg(" not recognised", CRLF);
+      break;
+
+    case CMD_BADARG:
+      countEvent(CNT_CMD_BADARG);
+      sendMsg(echo, NOLINE);
+      sendMsg(" invalid argument", CRLF);
+      break;
+
     }
   }
 }
@@ -162,27 +993,70 @@ void commandThread(void * arg) {
  *   Start kernel
  *---------------------------------------------------------------------------*/
 
+/*------------------------------------------------------------
+ *  Statically allocated RTOS objects
+ *      Sizes are set in ramBudget.h and listed by 'mem'
+ *------------------------------------------------------------*/
+static osRtxThread_t ledThreadCb RTX_SECTION("thread");
+static uint64_t ledThreadStack[LED_STACK_SIZE / 8];
+static const osThreadAttr_t ledThreadAttr = {
+  .name = "greenRedLED",
+  .cb_mem = & ledThreadCb, .cb_size = sizeof(ledThreadCb),
+  .stack_mem = ledThreadStack, .stack_size = sizeof(ledThreadStack),
+  .priority = LED_PRIORITY
+};
+
+static osRtxThread_t commandThreadCb RTX_SECTION("thread");
+static uint64_t commandThreadStack[COMMAND_STACK_SIZE / 8];
+static const osThreadAttr_t commandThreadAttr = {
+  .name = "command",
+  .cb_mem = & commandThreadCb, .cb_size = sizeof(commandThreadCb),
+  .stack_mem = commandThreadStack, .stack_size = sizeof(commandThreadStack),
+  .priority = COMMAND_PRIORITY
+};
+
+static osRtxMessageQueue_t controlIQCb RTX_SECTION("msgqueue");
+static uint32_t controlIQMem[osRtxMessageQueueMemSize(CONTROLIQ_COUNT, CONTROLIQ_MSG_SIZE) / 4];
+static const osMessageQueueAttr_t controlIQAttr = {
+  .name = "controlIQ",
+  .cb_mem = & controlIQCb, .cb_size = sizeof(controlIQCb),
+  .mq_mem = controlIQMem, .mq_size = sizeof(controlIQMem)
+};
+
 int main(void) {
 
   // System Initialization
   SystemCoreClockUpdate();
 
   // Initialise peripherals
-  configureGPIOoutput();
+  configureGPIOoutput(LED_DRIVER);
   //configureGPIOinput();
-  init_UART0(115200);
+  init_UART0(UART_BAUD, UART_TX_MODE);
+  initLowPower(LOW_POWER_MODE);
+#ifdef LATENCY_PROBE
+  initLatencyProbe();
+#endif
+
+#ifdef RTE_Compiler_EventRecorder
+  // Initialise event recording
+  EventRecorderInitialize(EventRecordAll, 1U);
+#endif
 
   // Initialize CMSIS-RTOS
   osKernelInitialize();
 
   // create message queue
-  controlIQ = osMessageQueueNew(2, 1, NULL);
+  controlIQ = osMessageQueueNew(CONTROLIQ_COUNT, CONTROLIQ_MSG_SIZE, & controlIQAttr);
   // initialise serial port 
   initSerialPort();
+  initFrames();
+  initSequencer();
 
   // Create threads
-  t_greenRedLED = osThreadNew(greenRedLEDThread, NULL, NULL);
-  t_command = osThreadNew(commandThread, NULL, NULL);
+  t_greenRedLED = osThreadNew(greenRedLEDThread, NULL, & ledThreadAttr);
+  t_command = osThreadNew(commandThread, NULL, & commandThreadAttr);
+  initStackMonitor();
+  initLogger();
 
   osKernelStart(); // Start thread execution - DOES NOT RETURN
   for (;;) {} // Only executed when an error occurs
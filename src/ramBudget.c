@@ -0,0 +1,58 @@
+/* ======================================================
+    ramBudget: statically allocated RAM, object by object
+
+    Every RTOS object is allocated statically, so the RTX 
+    dynamic memory pool (OS_DYNAMIC_MEM_SIZE) is 0. The table 
+    lists the RAM of each object, of the RTX kernel's own 
+    threads and queues (from RTX_Config.h) and of the larger 
+    buffers. The build fails if the total exceeds IRAM; the 
+    linker map remains the complete account, including the 
+    smaller variables.
+    ========================================================= */
+
+#include "RTX_Config.h"
+#include "ramBudget.h"
+#include "serialPort.h"
+#include "frame.h"
+#include "logger.h"
+#include "sequence.h"
+
+#define MAIN_STACK_SIZE (0x100)     // Stack_Size in startup_MKL25Z4.s: handlers
+#define RTX_TIMER_MSG_SIZE (8)      // timer callback queue entry
+
+// name, bytes
+#define RAM_BUDGET(X) \
+    X("main stack",          MAIN_STACK_SIZE) \
+    X("rtx dynamic pool",    OS_DYNAMIC_MEM_SIZE) \
+    X("rtx isr queue",       4 * OS_ISR_FIFO_QUEUE) \
+    X("rtx idle thread",     THREAD_RAM(OS_IDLE_THREAD_STACK_SIZE)) \
+    X("rtx timer thread",    THREAD_RAM(OS_TIMER_THREAD_STACK_SIZE)) \
+    X("rtx timer queue",     MSGQUEUE_RAM(OS_TIMER_CB_QUEUE, RTX_TIMER_MSG_SIZE)) \
+    X("greenRedLED thread",  THREAD_RAM(LED_STACK_SIZE)) \
+    X("command thread",      THREAD_RAM(COMMAND_STACK_SIZE)) \
+    X("stackMonitor thread", THREAD_RAM(MONITOR_STACK_SIZE)) \
+    X("logger thread",       THREAD_RAM(LOGGER_STACK_SIZE)) \
+    X("controlIQ",           MSGQUEUE_RAM(CONTROLIQ_COUNT, CONTROLIQ_MSG_SIZE)) \
+    X("frameQ",              MSGQUEUE_RAM(FRAMEQ_COUNT, sizeof(Frame_t))) \
+    X("ledDeadline timer",   TIMER_RAM) \
+    X("sendFlags",           EVFLAGS_RAM) \
+    X("readFlags",           EVFLAGS_RAM) \
+    X("tx buffer",           TXBUFSIZE) \
+    X("rx buffer",           RXBUFSIZE) \
+    X("log records",         LOG_RECORDS * sizeof(LogRecord_t)) \
+    X("pattern steps",       2 * SEQ_STEPS * sizeof(Step_t))
+
+#define ENTRY(name, bytes) { name, bytes },
+#define SUM(name, bytes) + (bytes)
+
+const RamBudget_t ramBudget[] = {
+    RAM_BUDGET(ENTRY)
+} ;
+const int ramBudgetCount = sizeof(ramBudget) / sizeof(ramBudget[0]) ;
+
+// Compile-time check: array size is negative if over budget
+typedef char ramBudgetFitsIRAM[((0 RAM_BUDGET(SUM)) <= IRAM_SIZE) ? 1 : -1] ;
+
+uint32_t ramBudgetTotal() {
+    return 0 RAM_BUDGET(SUM) ;
+}
@@ -0,0 +1,54 @@
+// Header file for the RAM budget
+//   Sizes of the statically allocated RTOS objects
+//   Function prototypes
+
+#ifndef RAMBUDGET_DEFS_H
+#define RAMBUDGET_DEFS_H
+
+#include "rtx_os.h"
+#include <stdint.h>
+
+#define IRAM_SIZE (0x4000)      // IRAM in lab4.uvprojx
+
+// Thread stacks, bytes - multiples of 8
+#define LED_STACK_SIZE (256)
+// command: 896 bytes on its deepest path, plus 25% as stackfit recommends.
+//   commandThread, dispatchCommand, baudCmd, sendMsgWait, sendWait and the
+//   SysTick read are 576 bytes of frames (gcc -fstack-usage, host, -O0);
+//   the RTX context is 64 and 256 is allowed for sprintf. Re-size from a
+//   board log of 'stacks' after every command has run (stackfit)
+#define COMMAND_STACK_SIZE (1120)     // margin 224
+// stackMonitor: 736 bytes plus 25%. monitorThread, reportStacks (its thread
+//   list and line) and the send path are 416 bytes of frames, measured as for
+//   the command stack; with the RTX context and sprintf that is 736
+#define MONITOR_STACK_SIZE (920)     // margin 184
+#define LOGGER_STACK_SIZE (384)      // snprintf and a LOG_LINE buffer
+
+// controlIQ: messages and bytes per message
+#ifndef CONTROLIQ_COUNT
+#define CONTROLIQ_COUNT (8)
+#endif
+#define CONTROLIQ_MSG_SIZE (12)     // ControlMsg_t in main.c
+
+// frameQ: received frames waiting for the command thread
+#define FRAMEQ_COUNT (8)
+
+// RAM used by an object: control block and any memory it owns
+#define THREAD_RAM(stack) (osRtxThreadCbSize + (stack))
+#define MSGQUEUE_RAM(count, size) (osRtxMessageQueueCbSize + osRtxMessageQueueMemSize(count, size))
+#define EVFLAGS_RAM (osRtxEventFlagsCbSize)
+#define TIMER_RAM (osRtxTimerCbSize)
+
+// Control block section, for the RTX5 component viewer
+#define RTX_SECTION(name) __attribute__((section(".bss.os." name ".cb")))
+
+typedef struct {
+    const char *name ;      // object
+    uint32_t bytes ;        // RAM allocated
+} RamBudget_t ;
+
+extern const RamBudget_t ramBudget[] ;
+extern const int ramBudgetCount ;
+uint32_t ramBudgetTotal(void) ;
+
+#endif
@@ -0,0 +1,83 @@
+/* ======================================================
+    sequence: double-buffered LED patterns
+
+   Interface
+     * seqAppend
+       - Add a step to the pattern being loaded
+     * seqCommit
+       - Hand the pattern loaded to the LED thread, which then
+         takes it with seqTake at a step boundary
+     * seqTake
+       - The pattern committed, if any; the buffer it replaces
+         becomes the one loaded next
+     * seqLoaded
+       - Steps loaded and not yet committed
+
+   There are two buffers of SEQ_STEPS packed steps: the LED
+   thread plays one while the command thread loads the other.
+   Once committed, the loaded buffer is not written again until
+   the LED thread has taken it, so neither thread waits for the
+   other and a pattern never changes while it plays. Loading
+   the next pattern is refused as busy until then.
+    ========================================================= */
+
+#include <stdbool.h>
+#include "sequence.h"
+
+static Step_t buffers[2][SEQ_STEPS] ;
+static unsigned int counts[2] ;
+static volatile unsigned int loading ;         // buffer loaded by the command thread
+static volatile bool committed ;        // loading buffer waits for the LED thread
+
+void initSequencer() {
+    loading = 0 ;
+    counts[0] = counts[1] = 0 ;
+    committed = false ;
+}
+
+/* --------------------------------
+     Add a step
+
+    Called by the command thread only
+   -------------------------------- */
+int seqAppend(unsigned int rgb, unsigned int ms) {
+    if (committed) return SEQ_BUSY ;
+    if (rgb > SEQ_RGB_MAX || ms == 0 || ms > SEQ_MS_MAX) return SEQ_BADARG ;
+    if (counts[loading] == SEQ_STEPS) return SEQ_FULL ;
+    buffers[loading][counts[loading]++] = SEQ_STEP(rgb, ms) ;
+    return SEQ_OK ;
+}
+
+/* --------------------------------
+     Commit the pattern loaded
+
+    Called by the command thread only, which then signals the
+    LED thread; committing again before the pattern is taken
+    has no effect, so that the signal may be repeated
+   -------------------------------- */
+int seqCommit() {
+    if (committed) return SEQ_OK ;
+    if (counts[loading] == 0) return SEQ_BADARG ;
+    committed = true ;
+    return SEQ_OK ;
+}
+
+/* --------------------------------
+     Take the pattern committed
+
+    Called by the LED thread only; false if none is waiting.
+    The pattern stays valid until the next is taken
+   -------------------------------- */
+bool seqTake(Pattern_t *pattern) {
+    if (!committed) return false ;
+    pattern->steps = buffers[loading] ;
+    pattern->count = counts[loading] ;
+    loading ^= 1 ;
+    counts[loading] = 0 ;
+    committed = false ;                 // after the switch: loading may resume
+    return true ;
+}
+
+unsigned int seqLoaded() {
+    return committed ? 0 : counts[loading] ;
+}
@@ -0,0 +1,45 @@
+// Header file for the LED sequencer
+//   Packed pattern steps, double-buffered patterns
+//   Function prototypes
+
+#ifndef SEQUENCE_DEFS_H
+#define SEQUENCE_DEFS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Steps per pattern
+#ifndef SEQ_STEPS
+#define SEQ_STEPS (256)
+#endif
+
+// A step: LEDs lit (LED_RED | LED_GREEN | LED_BLUE, as setLEDs) in
+//   the top 3 bits and the time they are lit, ms, in the low 13
+typedef uint16_t Step_t ;
+
+#define SEQ_MS_BITS (13)
+#define SEQ_MS_MAX ((1u << SEQ_MS_BITS) - 1)
+#define SEQ_RGB_MAX (0x7)
+#define SEQ_STEP(rgb, ms) ((Step_t)(((rgb) << SEQ_MS_BITS) | (ms)))
+#define SEQ_RGB(step) ((step) >> SEQ_MS_BITS)
+#define SEQ_MS(step) ((step) & SEQ_MS_MAX)
+
+// Pattern played by the LED thread
+typedef struct {
+    const Step_t *steps ;
+    unsigned int count ;
+} Pattern_t ;
+
+// values returned by seqAppend and seqCommit
+#define SEQ_OK (0)
+#define SEQ_BADARG (1)              // colour or time out of range, or no steps to play
+#define SEQ_FULL (2)                // SEQ_STEPS already loaded
+#define SEQ_BUSY (3)                // loading: the pattern committed has not yet been taken
+
+void initSequencer(void) ;
+int seqAppend(unsigned int rgb, unsigned int ms) ;
+int seqCommit(void) ;
+bool seqTake(Pattern_t *pattern) ;
+unsigned int seqLoaded(void) ;
+
+#endif
@@ -5,169 +5,491 @@
    Interface
      * sendMsg
        - Queue a message for transmission over the virtual serial port
-       - Non-blocking: small circular queue 
-       - Returns immediately without queuing message if queue full
-       - Message test not copied from buffer in user thread        
+       - Non-blocking: message copied into a circular byte buffer
+       - Returns immediately without queuing message if buffer full
+       - Caller's buffer may be reused once the call returns
+
+     * sendMsgWait
+       - As sendMsg, but blocks up to a timeout for buffer space
+
+     * getTxHighWater
+       - Maximum number of bytes held in the transmit buffer
+
+     * txIdle
+       - True when nothing remains to be transmitted
 
      * readLine
        - Single outstanding request 
        - Blocking: does not return until end of line read
-       - Reads characters until LF; CR ignored; use with local echo
+       - Reads characters until LF; CR ignored; backspace edits; use with local echo
+       - False for a line too long for the receive buffer, which is discarded
+       - Characters received between calls are buffered, so several 
+         lines may be queued
        - Message text written to buffer in user thread
+
+     * readLineWait
+       - As readLine, with a timeout
+
+     * getRxOverruns
+       - Number of received characters dropped because the buffer was full
+         
+     * getBaudInfo
+       - The baud rate set by init_UART0: the UART0 clock, divisor
+         and oversampling ratio chosen, and the error
+
+     * findBaud / setBaudRate
+       - The settings for another baud rate; change to it once 
+         queued bytes have been sent
+
+     * getTxStats / resetTxStats
+       - Bytes sent, transmit interrupts taken and cycles spent in them,
+         and the longest time a sender kept interrupts disabled
          
    The implememtation is interrupt driven
-       - Single ISR
-       - Interrupt when transmit buffer empty
+       - UART0 ISR
+       - Interrupt when transmit buffer empty (TX_INTERRUPT mode)
        - Interrupt when character received
+       - In TX_DMA mode, DMA channel 0 copies contiguous chunks of the
+         transmit buffer to UART0 and the DMA0 ISR runs once per chunk
        
    Section 1: Transmission data structure and functions
    Section 2: Receiving data structure and functions
    Section 3: Initialisation
-   Section 4: ISR
+   Section 4: ISRs
     ========================================================= */
 
 
 #include "cmsis_os2.h"
 #include <MKL25Z4.h>
 #include <stdbool.h>
+#include <string.h>
 #include "serialPort.h"
+#include "clock.h"
+#include "isrProfile.h"
+#include "latency.h"
+#include "counters.h"
+#include "events.h"
+#include "ramBudget.h"
+#include "frame.h"
 
 // ================ Section 1: Transmission ==================
 
 /* --------------------------------
-     Circular buffer for transmisison of messages
-
+     Circular byte buffer for transmission of messages
+
+   Message text (and any line ending) is copied into the buffer, so
+   the caller's string may be reused as soon as sendMsg returns. 
+   The head and tail indices run freely; the number of bytes held is 
+   (tail - head) and the buffer index is formed by masking. 
+
+   Senders reserve space and commit it, each in a critical region of
+   a few instructions; the message is copied between the two with 
+   interrupts enabled, so the time they are disabled does not grow
+   with the message length. Reserved bytes run from tail to reserve.
+   They are published to the ISR, by moving tail up to reserve, when
+   the last sender copying commits: a sender preempted while copying
+   holds back the messages reserved after its own, but not the space
+   already published.
    -------------------------------- */
-#define QMAXSIZE (4)    // queue entries - power of 2
-#define QMASK (3)       // mask for modulo arithmetic: entries - 1 
+#define TXMASK (TXBUFSIZE - 1)          // mask for modulo arithmetic
 
-// Send request type
-typedef struct {
-    char* buffer ;  // pointer to null terminated string
-    int line ;      // NOLINE, LFONLY, CRLF 
-} SendReq_t ;
+#if (TXBUFSIZE & TXMASK) != 0
+#error "TXBUFSIZE must be a power of 2"
+#endif
 
-// Circular queue of send requests
+#define CRCHAR (13)
+#define LFCHAR (10)
+
+// Circular buffer of bytes to send
 typedef struct {
-    SendReq_t requests[QMAXSIZE] ;  // queue of request
-    unsigned int head ;             // first occupied
-    unsigned int tail ;             // first UNOCCUPIED
-    unsigned int size ;             // need to distingush empty from full
-} volatile MsgQ_t ;
+    char buffer[TXBUFSIZE] ;        // message bytes
+    unsigned int head ;             // next byte to send - updated by ISR only
+    unsigned int tail ;             // end of the bytes published to the ISR
+    unsigned int reserve ;          // next free byte - updated by senders only
+    unsigned int writers ;          // senders holding space not yet committed
+    unsigned int highWater ;        // maximum number of bytes ever held
+    unsigned int waiting ;          // senders blocked waiting for space
+} volatile TxBuf_t ;
+
+// Declare the transmit buffer 
+TxBuf_t txBuf ;
+
+#define TXSPACE (0x1) 
+osEventFlagsId_t sendFlags ;        // event flag used to signal space freed
+static osRtxEventFlags_t sendFlagsCb RTX_SECTION("evflags") ;
+static const osEventFlagsAttr_t sendFlagsAttr = {
+    .name = "sendFlags", .cb_mem = &sendFlagsCb, .cb_size = sizeof(sendFlagsCb)
+} ;
+
+int txMode = TX_INTERRUPT ;         // TX_INTERRUPT or TX_DMA; set by init_UART0
+volatile unsigned int dmaCount ;    // bytes in the active DMA transfer; 0 if idle
+
+volatile TxStats_t txStats ;        // transmit measurements
+
+// Initialisation of the transmit buffer
+void initSendMsg() {
+    txBuf.head = 0 ;
+    txBuf.tail = 0 ;
+    txBuf.reserve = 0 ;
+    txBuf.writers = 0 ;
+    txBuf.highWater = 0 ;
+    txBuf.waiting = 0 ;
+    dmaCount = 0 ;
+    sendFlags = osEventFlagsNew(&sendFlagsAttr) ;
+}
 
-// Declare the message queue 
-MsgQ_t msgQueue ;
+/* --------------------------------
+     Record the length of an interrupts-disabled window
 
-// Initialisation of the message queue
-void initSendMsg() {
-    msgQueue.size = 0 ;
-    msgQueue.head = 0 ;
-    msgQueue.tail = 0 ;
+    * Caller holds the critical region, which began at the 
+      SysTick value start
+   -------------------------------- */
+static void noteMasked(uint32_t start) {
+    uint32_t cycles = sysTickElapsed(start) ;
+    
+    if (cycles > txStats.maskMax) txStats.maskMax = cycles ;
 }
 
 /* --------------------------------
-     Send a message
+     Reserve space in the transmit buffer
 
-    * Queue message for transmission on UART0
-    * The call does not block
-    * False is returned if the queue is full; true otherwise
+    * Caller must hold the critical region
+    * Space for the message and line ending is reserved as a unit;
+      false is returned, with nothing reserved, if there is not space
+    * On success *pos is the index of the first byte reserved
+   -------------------------------- */
+static bool reserveMsg(unsigned int size, unsigned int *pos) {
+    unsigned int start = txBuf.reserve ;
+    unsigned int used = start + size - txBuf.head ;
+    
+    if (used > TXBUFSIZE) return false ;
+    
+    txBuf.reserve = start + size ;
+    txBuf.writers++ ;
+    if (used > txBuf.highWater) txBuf.highWater = used ;
+    *pos = start ;
+    return true ;
+}
 
-   Concurrency:
-       - May be called from multiple threads
-       - Queue fields head and size also accessed by ISR
-       - Interrupts disabled for access to queue
+/* --------------------------------
+     Copy a message into reserved space
+
+    * Interrupts enabled: the space is the caller's alone
    -------------------------------- */
+static void copyMsg(unsigned int pos, const char *msg, unsigned int len, int eol) {
+    while (len--) {
+        txBuf.buffer[pos++ & TXMASK] = *msg++ ;
+    }
+    if (eol == CRLF) txBuf.buffer[pos++ & TXMASK] = CRCHAR ;
+    if (eol != NOLINE) txBuf.buffer[pos & TXMASK] = LFCHAR ;
+}
 
-bool sendMsg(char *msg, int eol) {
+/* --------------------------------
+     Start a DMA transfer
+
+    * Transfers the contiguous bytes from head to either the tail or the
+      end of the buffer, whichever comes first
+    * Called with interrupts disabled, or from the DMA0 ISR
+   -------------------------------- */
+static void startDMA(void) {
+    unsigned int head = txBuf.head ;
+    unsigned int count = txBuf.tail - head ;
+    unsigned int toEnd = TXBUFSIZE - (head & TXMASK) ;
     
-    // start critical region
-    int currentMask = __get_PRIMASK() ; 
-    __disable_irq() ;
+    if (count > toEnd) count = toEnd ;
+    dmaCount = count ;
+    if (count == 0) return ;
     
-    if (msgQueue.size == QMAXSIZE) {
-        // queue full
-        __set_PRIMASK(currentMask) ;
-        return false ; 
+    DMA0->DMA[0].SAR = (uintptr_t)&txBuf.buffer[head & TXMASK] ;
+    DMA0->DMA[0].DSR_BCR = DMA_DSR_BCR_BCR(count) ;
+    DMA0->DMA[0].DCR |= DMA_DCR_ERQ_MASK ;
+}
+
+/* --------------------------------
+     Start transmission of queued bytes
+
+    * Interrupt mode: enable the transmit interrupt
+    * DMA mode: start a transfer unless one is active
+    * Called with interrupts disabled
+   -------------------------------- */
+static void startTx(void) {
+    if (txMode == TX_DMA) {
+        if (dmaCount == 0) startDMA() ;
+    } else {
+        UART0->C2 |= UART0_C2_TIE(1) ;
     }
-    msgQueue.requests[msgQueue.tail].buffer = msg ;
-    msgQueue.requests[msgQueue.tail].line = eol ;
-    msgQueue.tail = (msgQueue.tail + 1) & QMASK ;
-    msgQueue.size++ ;
+}
+
+/* --------------------------------
+     Queue bytes, waiting for space if necessary
 
-    // ensure interrupt enabled
-    UART0->C2 |= UART0_C2_TIE(1) ;
+    * Copy message into the buffer for transmission on UART0
+    * Blocks for up to timeout ticks while the buffer is too full
+      to hold the whole message; a timeout of 0 does not block
+    * False is returned if the message could not be queued, and counted
+      as tx.dropped; true otherwise
+    * Messages longer than the buffer are always rejected
 
+   Concurrency:
+       - May be called from multiple threads
+       - Buffer field head also accessed by ISR
+       - Interrupts disabled only to reserve and to commit space,
+         not while the message is copied
+   -------------------------------- */
+static bool sendWait(const char *msg, unsigned int len, int eol, uint32_t timeout) {
+    uint32_t start = osKernelGetTickCount() ;
+    uint32_t waited, flags, maskStart ;
+    unsigned int pos ;
+    int currentMask ;
+    
+    // CRLF is 2 chars, LFONLY 1 and NOLINE 0
+    if (len + eol > TXBUFSIZE) {
+        countEvent(CNT_TX_DROPPED) ;
+        return false ;
+    }
+    
+    while (1) {
+        // start critical region
+        currentMask = __get_PRIMASK() ; 
+        __disable_irq() ;
+        maskStart = SysTick->VAL ;
+        
+        if (reserveMsg(len + eol, &pos)) {
+            noteMasked(maskStart) ;
+            __set_PRIMASK(currentMask) ;
+            break ;
+        }
+        
+        // buffer full: ask the ISR to signal when space is freed
+        waited = osKernelGetTickCount() - start ;
+        if (waited >= timeout) {
+            __set_PRIMASK(currentMask) ;
+            countEvent(CNT_TX_DROPPED) ;
+            return false ;
+        }
+        txBuf.waiting++ ;
+        noteMasked(maskStart) ;
+        __set_PRIMASK(currentMask) ;
+        // end critical region
+        
+        flags = osEventFlagsWait(sendFlags, TXSPACE, osFlagsWaitAny, 
+                    (timeout == osWaitForever) ? osWaitForever : timeout - waited) ;
+        currentMask = __get_PRIMASK() ; 
+        __disable_irq() ;
+        txBuf.waiting-- ;
+        __set_PRIMASK(currentMask) ;
+        if (flags & osFlagsError) {   // timed out
+            countEvent(CNT_TX_DROPPED) ;
+            return false ;
+        }
+    }
+    
+    copyMsg(pos, msg, len, eol) ;
+    
+    // commit: the last sender copying publishes all reserved bytes
+    currentMask = __get_PRIMASK() ; 
+    __disable_irq() ;
+    maskStart = SysTick->VAL ;
+    if (--txBuf.writers == 0) {
+        txBuf.tail = txBuf.reserve ;
+        // ensure transmission running
+        startTx() ;
+    }
+    noteMasked(maskStart) ;
     __set_PRIMASK(currentMask) ;
-    // end critical region
     
-    return true ;        
+    EVENT(EV_TX_ENQUEUE, len + eol, txBuf.reserve - txBuf.head) ;
+    return true ;
 }
 
 /* --------------------------------
-     Remove transmitted message
+     Send a message, waiting for space if necessary
+   -------------------------------- */
+bool sendMsgWait(char *msg, int eol, uint32_t timeout) {
+    return sendWait(msg, strlen(msg), eol, timeout) ;
+}
 
-   * Queue cannot be empty
-   * Return true if queue still non-empty
+/* --------------------------------
+     Send binary data
 
-   Called from ISR when request handled (all transmitted)
+    As sendMsgWait, for len bytes which may include nulls
    -------------------------------- */
-bool removeMsg() {
-    msgQueue.head = (msgQueue.head + 1) & QMASK  ;
-    msgQueue.size-- ;
-    return msgQueue.size ;
+bool sendBytes(const uint8_t *data, unsigned int len, uint32_t timeout) {
+    return sendWait((const char *)data, len, NOLINE, timeout) ;
 }
 
 /* --------------------------------
-     Get next charater to transmit from request at head
+     Send a message
 
+    * Queue message for transmission on UART0
+    * The call does not block
+    * False is returned if the buffer is full; true otherwise
    -------------------------------- */
-#define CRCHAR (13)
-#define LFCHAR (10)
+bool sendMsg(char *msg, int eol) {
+    return sendMsgWait(msg, eol, 0) ;
+}
 
-char getNextChar() {
-    // Case 1: current request not finished
-    char c = *msgQueue.requests[msgQueue.head].buffer ;
-    if (c != 0) {
-        msgQueue.requests[msgQueue.head].buffer++ ;
-        return c ;
-    }
-    
-    // Case 2: sending a CR 
-    if (msgQueue.requests[msgQueue.head].line == CRLF) {
-        msgQueue.requests[msgQueue.head].line-- ;
-        return CRCHAR;
-    }
-    // Case 3: sending a LF 
-    if (msgQueue.requests[msgQueue.head].line == LFONLY) {
-        msgQueue.requests[msgQueue.head].line-- ;
-        return LFCHAR ;
-    }
-    return 0 ;
+/* --------------------------------
+     Transmit buffer high-water mark
+
+    Largest number of bytes held in the buffer since initialisation,
+    used to check that TXBUFSIZE is large enough
+   -------------------------------- */
+unsigned int getTxHighWater() {
+    return txBuf.highWater ;
+}
+
+/* --------------------------------
+     Transmitter idle
+
+    True when the buffer is empty, with no space reserved, and the 
+    last byte has left the shift register; the UART0 clock can then 
+    be stopped
+   -------------------------------- */
+bool txIdle() {
+    return (txBuf.head == txBuf.reserve) && (UART0->S1 & UART0_S1_TC_MASK) ;
+}
+
+/* --------------------------------
+     Transmit measurements
+
+    Counts of bytes sent and of transmit interrupts (UART0 TDRE or
+    DMA0 done, depending on mode) together with the CPU cycles spent
+    in those interrupts, measured using SysTick. Comparing the two
+    modes gives the interrupt count and CPU load per kilobyte.
+    maskMax is the longest a sender has kept interrupts disabled.
+   -------------------------------- */
+void getTxStats(TxStats_t *stats) {
+    int currentMask = __get_PRIMASK() ; 
+    __disable_irq() ;
+    *stats = txStats ;
+    __set_PRIMASK(currentMask) ;
+}
+
+void resetTxStats() {
+    int currentMask = __get_PRIMASK() ; 
+    __disable_irq() ;
+    txStats.bytes = 0 ;
+    txStats.irqs = 0 ;
+    txStats.cycles = 0 ;
+    txStats.maskMax = 0 ;
+    __set_PRIMASK(currentMask) ;
 }
 
 
 // =============Section 2: Receive Message =============================
 
-// Read request type
+/* --------------------------------
+     Circular byte buffer for received characters
+
+   Single producer (the ISR) and single consumer (readLine): the ISR 
+   only writes tail and the consumer only writes head, so no critical 
+   region is needed. Indices run freely, as for the transmit buffer.
+   Characters are kept while no readLine is outstanding, so lines 
+   typed or pasted between prompts are queued rather than lost.
+
+   A line that does not fit is cut short: the last byte buffered is
+   replaced by a CAN marker, which ends the line for the reader, and
+   the rest of the line up to and including its LF is discarded.
+   Each byte dropped counts as an overrun.
+   -------------------------------- */
+#define RXMASK (RXBUFSIZE - 1)          // mask for modulo arithmetic
+
+#if (RXBUFSIZE & RXMASK) != 0
+#error "RXBUFSIZE must be a power of 2"
+#endif
+
+#define BSCHAR (8)
+#define CANCHAR (24)                    // ends a line cut short
+#define DELCHAR (127)
+
+// Circular buffer of received bytes
 typedef struct {
-    char* buffer ;  // pointer to null terminated string
-    int maxIndex ;  // maximum index: num chars - 1; buffer must be +1 in length, for null 
-    int index ;     // current buffer index
-} readReq_t ;
+    char buffer[RXBUFSIZE] ;        // received bytes
+    unsigned int head ;             // next byte to read - updated by readLine only
+    unsigned int tail ;             // next free byte - updated by ISR only
+} volatile RxBuf_t ;
 
 // data structures
-volatile readReq_t readReq ;
+RxBuf_t rxBuf ;
+volatile bool reading ;               // a readLine is outstanding
+volatile bool rxFraming ;             // received bytes go to the frame parser
+volatile bool rxDiscarding ;          // dropping the rest of a line cut short - ISR only
 
-#define READCOMPLETE (0x1) 
-osEventFlagsId_t readFlags ;          // event flag used to signal read completion
+#define LINEREADY (0x1) 
+osEventFlagsId_t readFlags ;          // event flag used to signal a LF received
+static osRtxEventFlags_t readFlagsCb RTX_SECTION("evflags") ;
+static const osEventFlagsAttr_t readFlagsAttr = {
+    .name = "readFlags", .cb_mem = &readFlagsCb, .cb_size = sizeof(readFlagsCb)
+} ;
 
 
 void initReadReq() {
-    readReq.buffer = NULL ;
-    readReq.index = 0 ;
-    readFlags = osEventFlagsNew(NULL) ;
+    rxBuf.head = 0 ;
+    rxBuf.tail = 0 ;
+    reading = false ;
+    rxFraming = false ;
+    rxDiscarding = false ;
+    readFlags = osEventFlagsNew(&readFlagsAttr) ;
 }
 
+/* -------------------------------------
+      Store received character
+
+   Called from ISR
+
+   Return true if the character ends a line, or a line has
+   been cut short
+------------------------------------- */
+bool setNextChar(char c) {
+    unsigned int tail = rxBuf.tail ;
+    unsigned int last = (tail - 1) & RXMASK ;
+
+    // drop the rest of a line cut short, up to its LF
+    if (rxDiscarding) {
+        countEvent(CNT_RX_OVERRUNS) ;
+        if (c == LFCHAR) rxDiscarding = false ;
+        return false ;
+    }
+
+    // buffer full: drop character and cut the line short. The reader
+    //   is RXBUFSIZE bytes behind, so the last byte is not being read
+    if (tail - rxBuf.head == RXBUFSIZE) {
+        countEvent(CNT_RX_OVERRUNS) ;
+        if (c != LFCHAR) rxDiscarding = true ;
+        if (rxBuf.buffer[last] == LFCHAR) return false ;   // a whole line lost
+        rxBuf.buffer[last] = CANCHAR ;
+        return true ;
+    }
+    rxBuf.buffer[tail & RXMASK] = c ;
+    rxBuf.tail = tail + 1 ;   // publish after the character is written
+    return (c == LFCHAR) ;
+}
+
+/* -------------------------------------
+      Switch received bytes to or from the frame parser
+
+   Bytes already buffered but not read, such as frames sent
+   straight after the command that enabled framing, are passed
+   to the parser first. The UART0 interrupt, rather than all
+   interrupts, is disabled meanwhile: the parser puts to a 
+   message queue, which needs the SVC call.
+
+   Called by the reading thread only
+------------------------------------- */
+void setRxFraming(bool on) {
+    NVIC_DisableIRQ(UART0_IRQn) ;
+    if (on && !rxFraming) {
+        resetFrameParser() ;
+        rxDiscarding = false ;
+        while (rxBuf.head != rxBuf.tail) {
+            frameRxByte(rxBuf.buffer[rxBuf.head & RXMASK]) ;
+            rxBuf.head++ ;
+        }
+    }
+    rxFraming = on ;
+    NVIC_EnableIRQ(UART0_IRQn) ;
+}
 
 /* ------------------------------------------
      Read a line
@@ -183,71 +505,94 @@ void initReadReq() {
     character is written. Additional characters received after maxChar and 
     before LF are discared
 
+    Line discipline: CR is ignored; backspace or delete removes the 
+      previous character of the line
+
+    False is returned, with msg empty, for a line cut short because
+      the receive buffer was full (see above)
+
     Concurrency: 
-       1. Two threads could attempt to call this at the same time, 
-          causing a race condition on the read request buffer and index. We disable interrupts
-          on the buffer test and update.
-       2. The ISR updates both buffer and index, but guarded by buffer not null 
+       1. Two threads could attempt to call this at the same time; 
+          only one outstanding request is allowed. We disable 
+          interrupts on the test and update of the reading flag.
+       2. The ISR only adds to the receive buffer (see above)
    ------------------------------------------ */
 bool readLine (char *msg, int maxChars) {
+    return readLineWait(msg, maxChars, osWaitForever) ;
+}
+
+/* ------------------------------------------
+   readLineWait
+     As readLine, but gives up after timeout ticks without a 
+     complete line, returning false; the part line read is lost
+   ------------------------------------------ */
+bool readLineWait (char *msg, int maxChars, uint32_t timeout) {
+    uint32_t start = osKernelGetTickCount() ;
+    uint32_t waited ;
+    int index = 0 ;
+    bool cut = false ;
+    char c ;
     
     // start critical region
     int currentMask = __get_PRIMASK() ; 
     __disable_irq() ;
     
     // check if an outstanding request
-    if (readReq.buffer != NULL) {
+    if (reading) {
         __set_PRIMASK(currentMask) ;
         return false ;
     }
-    readReq.buffer = msg ;
+    reading = true ;
     __set_PRIMASK(currentMask) ;
     // end critical region
     
-    readReq.index = 0 ;
-    readReq.maxIndex = maxChars ;
-    
-    // buffer is filled in the interrupt handler 
+    while (1) {
+        // wait for a complete line if nothing buffered
+        if (rxBuf.head == rxBuf.tail) {
+            if (timeout == osWaitForever) {
+                osEventFlagsWait (readFlags, LINEREADY, osFlagsWaitAny, osWaitForever);
+                continue ;
+            }
+            waited = osKernelGetTickCount() - start ;
+            if (waited >= timeout ||
+                osEventFlagsWait (readFlags, LINEREADY, osFlagsWaitAny, timeout - waited) == osFlagsErrorTimeout) {
+                reading = false ;
+                return false ;
+            }
+            continue ;
+        }
+        c = rxBuf.buffer[rxBuf.head & RXMASK] ;
+        rxBuf.head++ ;
+        
+        if (c == LFCHAR) break ;
+        if (c == CANCHAR) {
+            index = 0 ;
+            cut = true ;
+            break ;
+        }
+        if (c == CRCHAR) continue ;
+        if (c == BSCHAR || c == DELCHAR) {
+            if (index > 0) index-- ;
+            continue ;
+        }
+        // drop character if buffer full
+        if (index < maxChars) msg[index++] = c ;
+    }
+    msg[index] = 0 ;
+    EVENT(EV_RX_DEQUEUE, index, rxBuf.tail - rxBuf.head) ;
     
-    // wait for completion
-    osEventFlagsWait (readFlags, READCOMPLETE, osFlagsWaitAny, osWaitForever);
-    return true ;
+    reading = false ;
+    return !cut ;
 }
 
-/* -------------------------------------
-      Update with received character
-
-   Called from ISR
-
-   A character has been received. Write it to the buffer.
-    - Detect end of message
-    - Prevent buffer overflow
+/* --------------------------------
+     Receive overrun count
 
-   End of message: signalled on a LF. CR is ignored.
-   When the end of the buffer provided by the is reached, further
-     characters are dropped
-   Return true to signal line complete
-------------------------------------- */
-bool setNextChar(char c) {
-    // ignore if no request active
-    if (readReq.buffer == NULL) return false ; 
-    // ignore a CR
-    if (c == CRCHAR) return false ;
-    
-    // LF or buffer full ends the read
-    if (c == LFCHAR) {
-        readReq.buffer[readReq.index] = 0 ;
-        readReq.buffer = NULL ;
-        return true ;
-    }
-    
-    // write character to buffer if not full
-    if (readReq.index < readReq.maxIndex) {
-        // buffer not full
-        readReq.buffer[readReq.index++] = c ;
-    }
-    // drop character if buffer full
-    return false;
+    Number of characters dropped because the receive buffer was full,
+    since the counters were last reset: the rx.overruns counter
+   -------------------------------- */
+unsigned int getRxOverruns() {
+    return counters[CNT_RX_OVERRUNS] ;
 }
 
 // ============= Section 3: Initialisation =======================
@@ -256,12 +601,97 @@ bool setNextChar(char c) {
    Configure UART0 for serial I/O via the debug 
    system to the PC, using interrupts
  * ---------------------------------------- */
-#define SYS_CLOCK (20971520)  // default system clock
-#define OVERSAMPLE_RATE (13)  // chosen to minimise rounding error
+#define OSR_MIN (4)           // oversampling ratios supported by UART0
+#define OSR_MAX (32)
+#define OSR_BOTHEDGE (8)      // below this, sample on both clock edges
+#define SBR_MAX (0x1FFF)      // 13-bit baud rate divisor
 #define RxPIN (1)             // Pin PTA1 fixed by development board design
 #define TxPIN (2)             // Pin PTA2 fixed by development board design
+#define DMAMUX_UART0_TX (3)   // DMAMUX source number for UART0 transmit
 
-void init_UART0(uint32_t baud_rate) {
+/* ----------------------------------------
+   Configure DMA channel 0 to feed UART0 transmit
+     - Source: transmit buffer, 8 bit, incrementing
+     - Destination: UART0 data register, 8 bit, fixed
+     - One byte per UART0 TDRE request (cycle steal)
+     - Request disabled and interrupt raised when the count reaches 0
+ * ---------------------------------------- */
+static void init_DMA0(void) {
+    // Enable clocks
+    SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK ;
+    SIM->SCGC7 |= SIM_SCGC7_DMA_MASK ;
+    
+    // Route UART0 transmit requests to channel 0
+    DMAMUX0->CHCFG[0] = 0 ;
+    DMA0->DMA[0].DSR_BCR = DMA_DSR_BCR_DONE_MASK ;
+    DMA0->DMA[0].DAR = (uintptr_t)&UART0->D ;
+    DMA0->DMA[0].DCR = DMA_DCR_EINT_MASK | DMA_DCR_CS_MASK | DMA_DCR_SINC_MASK | 
+                       DMA_DCR_SSIZE(1) | DMA_DCR_DSIZE(1) | DMA_DCR_D_REQ_MASK ;
+    DMAMUX0->CHCFG[0] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(DMAMUX_UART0_TX) ;
+    
+    // TDRE generates DMA requests
+    UART0->C5 |= UART0_C5_TDMAE_MASK ;
+    
+    // Enable the interrupt
+    NVIC_SetPriority(DMA0_IRQn, 128) ;
+    NVIC_ClearPendingIRQ(DMA0_IRQn) ;
+    NVIC_EnableIRQ(DMA0_IRQn) ;
+}
+
+static BaudInfo_t baudInfo ;
+
+/* ----------------------------------------
+   Choose the divisor and oversampling ratio
+
+   The baud rate is clock / (sbr x osr). Each ratio from 32
+   down is tried with the divisor rounded to nearest, and the
+   first with the least error kept, so that of equally good
+   settings the one sampling each bit most often is used
+ * ---------------------------------------- */
+static void chooseBaud(uint32_t clock, uint32_t baud_rate, BaudInfo_t *info) {
+    uint32_t osr, sbr, actual, error, bestError = UINT32_MAX ;
+
+    info->requested = baud_rate ;
+    info->clock = clock ;
+    for (osr = OSR_MAX ; osr >= OSR_MIN ; osr--) {
+        sbr = (clock + baud_rate * osr / 2) / (baud_rate * osr) ;
+        if (sbr == 0) sbr = 1 ;
+        if (sbr > SBR_MAX) continue ;
+        actual = clock / (sbr * osr) ;
+        error = (actual > baud_rate) ? actual - baud_rate : baud_rate - actual ;
+        if (error < bestError) {
+            bestError = error ;
+            info->sbr = sbr ;
+            info->osr = osr ;
+        }
+    }
+    info->errorPpm = (int32_t)((int64_t)clock * 1000000 /
+                               ((int64_t)baud_rate * info->sbr * info->osr) - 1000000) ;
+}
+
+// Program the divisor and oversampling ratio in baudInfo
+//   The transmitter and receiver must be disabled
+static void writeBaud(void) {
+    // Set baud rate and over-sampling ratio
+    //    Receiver clock multiplied by over-sampling 
+    UART0->BDH &= ~UART0_BDH_SBR_MASK ;
+    UART0->BDH |= UART0_BDH_SBR(baudInfo.sbr >> 8) ;
+    UART0->BDL = UART0_BDL_SBR(baudInfo.sbr) ;
+    
+    // Set oversample rate
+    //    This must be done in a single write, as zero in invalid and cause 0xF to be written 
+    //    Other bits C4 are zero
+    UART0->C4 = baudInfo.osr - 1 ; 
+    if (baudInfo.osr < OSR_BOTHEDGE) {
+        UART0->C5 |= UART0_C5_BOTHEDGE_MASK ;
+    } else {
+        UART0->C5 &= ~UART0_C5_BOTHEDGE_MASK ;
+    }
+}
+
+void init_UART0(uint32_t baud_rate, int mode) {
+    
+    txMode = mode ;
     
     // Enable clock
     SIM->SCGC4 |= SIM_SCGC4_UART0_MASK ;  // UART0
@@ -271,26 +701,14 @@ void init_UART0(uint32_t baud_rate) {
     //   Required for configuration
     UART0->C2 &= ~UART0_C2_TE_MASK & ~UART0_C2_RE_MASK ;
     
-    // Set UART0 clock to CPU clock
-    SIM->SOPT2 |= SIM_SOPT2_UART0SRC(1) ;
-    //SIM->SOPT2 |= SIM_SOPT2_PLLFLLSEL_MASK ; // this does not work
+    // Set UART0 clock for the clock profile
+    chooseBaud(uart0Clock(), baud_rate, &baudInfo) ;
     
     // Set pin multiplexing to UART0 Rx and Tx
     PORTA->PCR[RxPIN] = PORT_PCR_ISF_MASK | PORT_PCR_MUX(2) ; 
     PORTA->PCR[TxPIN] = PORT_PCR_ISF_MASK | PORT_PCR_MUX(2) ; 
     
-    // Set baud rate and over-sampling ratio
-    //    Receiver clock multiplied by over-sampling 
-    uint16_t sbr ;
-    sbr = (uint16_t)((SYS_CLOCK) / (baud_rate * OVERSAMPLE_RATE)) ;
-    UART0->BDH &= ~UART0_BDH_SBR_MASK ;
-    UART0->BDH |= UART0_BDH_SBR(sbr >> 8) ;
-    UART0->BDL = UART0_BDL_SBR(sbr) ;
-    
-    // Set oversample rate
-    //    This must be done in a single write, as zero in invalid and cause 0xF to be written 
-    //    Other bits C4 are zero
-    UART0->C4 = OVERSAMPLE_RATE-1 ; 
+    writeBaud() ;
     
     // Select one stop bit
     // Disable interrupts for Rx active edge and LIN break detect
@@ -316,11 +734,55 @@ void init_UART0(uint32_t baud_rate) {
     
     // Enable the data recievd interrupt
     UART0->C2 |= UART0_C2_RIE(1) ;
+    
+    // Optionally, transmit using DMA
+    if (txMode == TX_DMA) init_DMA0() ;
 
     // Enable transmitter and receiver
     UART0->C2 |= UART0_C2_TE(1) | UART0_C2_RE(1) ;
 }
 
+void getBaudInfo(BaudInfo_t *info) {
+    *info = baudInfo ;
+}
+
+// The settings setBaudRate would choose, without applying them
+void findBaud(uint32_t baud_rate, BaudInfo_t *info) {
+    chooseBaud(baudInfo.clock, baud_rate, info) ;
+}
+
+/* ----------------------------------------
+   Change the baud rate once transmission is complete
+
+   Returns false, leaving the rate unchanged, if the error would
+   exceed BAUD_ERROR_MAX. Bytes queued are sent at the old rate
+   first; those received but not yet read are discarded, as are
+   any garbled by the change. Call from a thread, after the 
+   kernel has started.
+ * ---------------------------------------- */
+bool setBaudRate(uint32_t baud_rate) {
+    BaudInfo_t info ;
+
+    chooseBaud(baudInfo.clock, baud_rate, &info) ;
+    if (info.errorPpm > BAUD_ERROR_MAX || info.errorPpm < -BAUD_ERROR_MAX) return false ;
+
+    // wait for the buffer, then the shift register, to empty
+    while (!txIdle()) osDelay(1) ;
+    while (!(UART0->S1 & UART0_S1_TC_MASK)) ;
+
+    // start critical region
+    int currentMask = __get_PRIMASK() ;
+    __disable_irq() ;
+    UART0->C2 &= ~UART0_C2_TE_MASK & ~UART0_C2_RE_MASK ;
+    baudInfo = info ;
+    writeBaud() ;
+    rxBuf.head = rxBuf.tail ;
+    UART0->C2 |= UART0_C2_TE(1) | UART0_C2_RE(1) ;
+    __set_PRIMASK(currentMask) ;
+    // end critical region
+    return true ;
+}
+
 /* --------------------------------------
      Initialisation of tyhe serial port
         Call after the kernel initialisation
@@ -348,42 +810,89 @@ void initSerialPort() {
 
 void UART0_IRQHandler(void) {
     char c ;
+    uint32_t start = SysTick->VAL ;
+    uint8_t errors ;
+    ISR_PROFILE_ENTRY() ;
     
     // handle errors by reading character and discarding 
-    if (UART0->S1 & (UART_S1_OR_MASK | UART_S1_NF_MASK | UART_S1_FE_MASK | UART_S1_PF_MASK)) {
+    errors = UART0->S1 & (UART_S1_OR_MASK | UART_S1_NF_MASK | UART_S1_FE_MASK | UART_S1_PF_MASK) ;
+    if (errors) {
+        if (errors & UART_S1_OR_MASK) countEvent(CNT_UART_OR) ;
+        if (errors & UART_S1_NF_MASK) countEvent(CNT_UART_NF) ;
+        if (errors & UART_S1_FE_MASK) countEvent(CNT_UART_FE) ;
+        if (errors & UART_S1_PF_MASK) countEvent(CNT_UART_PF) ;
+
         // read the character to clear RDRF
         c = UART0->D ; // resets the RDRF flag
         
         // reset the error flags
         UART0->S1 |= UART_S1_OR_MASK | UART_S1_NF_MASK | UART_S1_FE_MASK | UART_S1_PF_MASK ;
+        ISR_PROFILE_EXIT(ISR_PATH_ERROR) ;
     }
     
     // handle ready to transmit request
     if ((UART0->C2 & UART0_C2_TIE_MASK) && (UART0->S1 & UART0_S1_TDRE_MASK)) {
-        // Case 1: this request not finished
-        c = getNextChar() ;
-        if (c) {
-            UART0->D = c ;
-        
-        // Case 2: next request            
-        } else if (removeMsg()) {
-            UART0->D = getNextChar() ;  // next request must have something
-
-        // Case 3: request queue empty: disable transmission interrupt
+        // Case 1: bytes waiting - send the next
+        if (txBuf.head != txBuf.tail) {
+            UART0->D = txBuf.buffer[txBuf.head & TXMASK] ;
+            txBuf.head++ ;
+            txStats.bytes++ ;
+            
+            // wake a sender waiting for space; the flag is set again
+            //   for each byte until every waiting sender has run
+            if (txBuf.waiting) osEventFlagsSet(sendFlags, TXSPACE) ;
+
+        // Case 2: buffer empty: disable transmission interrupt
         } else {
             UART0->C2 &= ~UART0_C2_TIE_MASK ;
+            EVENT(EV_TX_DEQUEUE, txStats.bytes, 0) ;
         }
+        txStats.irqs++ ;
+        txStats.cycles += sysTickElapsed(start) ;
+        ISR_PROFILE_EXIT(ISR_PATH_TX) ;
     }
     
     // handle character received 
     if (UART0->S1 & UART0_S1_RDRF_MASK) {
         c = UART0->D ; // resets the RDRF flag
         
-        // update buffer or discard char
-        if (setNextChar(c)) {
-            osEventFlagsSet(readFlags, READCOMPLETE);
+        // buffer char; signal reader on end of line
+        if (rxFraming) {
+            frameRxByte(c) ;
+        } else if (setNextChar(c)) {
+            LATENCY_LINE_END() ;
+            EVENT(EV_RX_ENQUEUE, rxBuf.tail - rxBuf.head, counters[CNT_RX_OVERRUNS]) ;
+            osEventFlagsSet(readFlags, LINEREADY);
         }
+        ISR_PROFILE_EXIT(ISR_PATH_RX) ;
     }
+    ISR_PROFILE_EXIT(ISR_PATH_ALL) ;
 }
 
+/* --------------------------------
+      DMA0 Interrupt handler
 
+   Raised when a transfer of a contiguous chunk of the transmit
+   buffer to UART0 is complete. The bytes are released from the 
+   buffer and the next chunk, if any, is started.
+   -------------------------------- */
+
+void DMA0_IRQHandler(void) {
+    uint32_t start = SysTick->VAL ;
+    ISR_PROFILE_ENTRY() ;
+    
+    // clear done flag and errors
+    DMA0->DMA[0].DSR_BCR = DMA_DSR_BCR_DONE_MASK ;
+    
+    txBuf.head += dmaCount ;
+    txStats.bytes += dmaCount ;
+    startDMA() ;
+    EVENT(EV_TX_DEQUEUE, txStats.bytes, txBuf.tail - txBuf.head) ;
+    
+    // wake a sender waiting for space; set again for each chunk
+    //   until every waiting sender has run
+    if (txBuf.waiting) osEventFlagsSet(sendFlags, TXSPACE) ;
+    txStats.irqs++ ;
+    txStats.cycles += sysTickElapsed(start) ;
+    ISR_PROFILE_EXIT(ISR_PATH_TX) ;
+}
@@ -12,9 +12,52 @@
 #define LFONLY (1)
 #define CRLF (2)
 
-void init_UART0(uint32_t baud_rate) ;
+// values used for init_UART0 mode parameter
+#define TX_INTERRUPT (0)    // one UART0 interrupt per byte sent
+#define TX_DMA (1)          // DMA channel 0; one DMA0 interrupt per chunk sent
+
+// Buffer sizes, bytes - powers of 2
+#ifndef TXBUFSIZE
+#define TXBUFSIZE (512)     // 256 to 2048
+#endif
+#ifndef RXBUFSIZE
+#define RXBUFSIZE (256)
+#endif
+
+#define BAUD_ERROR_MAX (20000) // ppm: the largest baud error setBaudRate accepts
+
+// UART0 baud rate setting
+typedef struct {
+    uint32_t requested ;    // baud rate asked of init_UART0
+    uint32_t clock ;        // UART0 clock, Hz
+    uint32_t sbr ;          // baud rate divisor, 1 to 8191
+    uint32_t osr ;          // oversampling ratio, 4 to 32
+    int32_t errorPpm ;      // clock / (sbr x osr) against requested, parts per million
+} BaudInfo_t ;
+
+// Transmit measurements
+typedef struct {
+    uint32_t bytes ;        // bytes transmitted
+    uint32_t irqs ;         // transmit interrupts taken
+    uint32_t cycles ;       // CPU cycles spent handling them
+    uint32_t maskMax ;      // longest interrupts-disabled window in a sender, cycles
+} TxStats_t ;
+
+void init_UART0(uint32_t baud_rate, int mode) ;
 void initSerialPort(void) ;
+void getBaudInfo(BaudInfo_t *info) ;
+void findBaud(uint32_t baud_rate, BaudInfo_t *info) ;
+bool setBaudRate(uint32_t baud_rate) ;
 bool sendMsg(char *msg, int eol) ;
+bool sendMsgWait(char *msg, int eol, uint32_t timeout) ;
+bool sendBytes(const uint8_t *data, unsigned int len, uint32_t timeout) ;
+unsigned int getTxHighWater(void) ;
+bool txIdle(void) ;
+void getTxStats(TxStats_t *stats) ;
+void resetTxStats(void) ;
 bool readLine (char *msg, int maxChars) ; 
+bool readLineWait (char *msg, int maxChars, uint32_t timeout) ;
+unsigned int getRxOverruns(void) ;
+void setRxFraming(bool on) ;
 
 #endif
@@ -0,0 +1,79 @@
+/* ======================================================
+    stacks: thread stack use
+
+   Interface
+     * reportStacks
+       - One line per thread, including the RTX idle and timer 
+         threads: "stack <name> size <bytes> used <bytes>"
+       - Used is the deepest the stack has been, from the RTX 
+         watermark (OS_STACK_WATERMARK in RTX_Config.h)
+
+     * setStackReport
+       - Repeat the report every given number of seconds, from a
+         low priority monitor thread; 0 stops it. At most
+         STACK_REPORT_MAX seconds
+
+   host/tools/stackfit reads a log of repeated reports and 
+   recommends a size for each stack.
+    ========================================================= */
+
+#include "cmsis_os2.h"
+#include <stdio.h>
+#include "ramBudget.h"
+#include "serialPort.h"
+#include "stacks.h"
+
+#define MAX_THREADS (8)
+#define PERIOD_SET (0x1)            // thread flag: report period changed
+
+static volatile uint32_t reportPeriod ;     // seconds; 0 for none
+static osThreadId_t t_monitor ;
+
+static osRtxThread_t monitorThreadCb RTX_SECTION("thread") ;
+static uint64_t monitorThreadStack[MONITOR_STACK_SIZE / 8] ;
+static const osThreadAttr_t monitorThreadAttr = {
+    .name = "stackMonitor",
+    .cb_mem = &monitorThreadCb, .cb_size = sizeof(monitorThreadCb),
+    .stack_mem = monitorThreadStack, .stack_size = sizeof(monitorThreadStack),
+    .priority = osPriorityBelowNormal
+} ;
+
+void reportStacks() {
+    osThreadId_t threads[MAX_THREADS] ;
+    char line[48] ;
+    const char *name ;
+    uint32_t count, size ;
+    
+    count = osThreadEnumerate(threads, MAX_THREADS) ;
+    for (uint32_t t = 0 ; t < count ; t++) {
+        name = osThreadGetName(threads[t]) ;
+        size = osThreadGetStackSize(threads[t]) ;
+        sprintf(line, "stack %s size %u used %u", (name != NULL) ? name : "?", 
+                size, size - osThreadGetStackSpace(threads[t])) ;
+        sendMsgWait(line, CRLF, osWaitForever) ;
+    }
+}
+
+// Waits for the period, or for it to change
+static void monitorThread(void *arg) {
+    uint32_t flags ;
+    
+    while (1) {
+        if (reportPeriod == 0) {
+            flags = osThreadFlagsWait(PERIOD_SET, osFlagsWaitAny, osWaitForever) ;
+        } else {
+            flags = osThreadFlagsWait(PERIOD_SET, osFlagsWaitAny, reportPeriod * osKernelGetTickFreq()) ;
+        }
+        if (flags == osFlagsErrorTimeout) reportStacks() ;
+    }
+}
+
+void initStackMonitor() {
+    reportPeriod = 0 ;
+    t_monitor = osThreadNew(monitorThread, NULL, &monitorThreadAttr) ;
+}
+
+void setStackReport(uint32_t seconds) {
+    reportPeriod = seconds ;
+    osThreadFlagsSet(t_monitor, PERIOD_SET) ;
+}
@@ -0,0 +1,16 @@
+// Header file for the thread stack report
+//   Function prototypes
+
+#ifndef STACKS_DEFS_H
+#define STACKS_DEFS_H
+
+#include <stdint.h>
+
+// longest report period, seconds; keeps the period in ticks within 32 bits
+#define STACK_REPORT_MAX (3600)
+
+void initStackMonitor(void) ;
+void reportStacks(void) ;
+void setStackReport(uint32_t seconds) ;
+
+#endif